@@ -96,6 +96,21 @@ bool AddressBar::handleReturn(int mask) {
     return true;
 }
 
+// A command name is completed from the index of PATH,
+// anything else like a path or an argument by globbing.
+void AddressBar::complete() {
+    mstring text(getText());
+    if (text.isEmpty() || strpbrk(text, " \t/~*?[]\\$'\"`") != nullptr) {
+        YInputLine::complete();
+        return;
+    }
+
+    mstring best;
+    int count = commands->complete(text, &best);
+    if (1 <= count)
+        setText(best, count == 1);
+}
+
 void AddressBar::changeLocation(int newLocation) {
     if (! inrange(newLocation, 0, history.getCount()))
         return;
@@ -2,6 +2,7 @@
 #define __ADDRBAR_H
 
 #include "yinputline.h"
+#include "aexecindex.h"
 
 class IApp;
 
@@ -12,6 +13,7 @@ public:
 
     virtual bool handleKey(const XKeyEvent &key);
     virtual void handleFocus(const XFocusChangeEvent &focus);
+    virtual void complete();
 
     void showNow();
     void hideNow();
@@ -24,6 +26,7 @@ private:
     IApp *app;
     MStringArray history;
     int location;
+    lazy<ExecIndex> commands;
 };
 
 #endif
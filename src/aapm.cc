@@ -1088,7 +1088,7 @@ bool YApm::handleTimer(YTimer *t) {
     if (updateState()) {
         if (toolTipVisible())
             updateToolTip();
-        repaint();
+        invalidate();
     }
     return true;
 }
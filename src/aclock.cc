@@ -202,7 +202,7 @@ void YClock::changeTimeFormat(const char* format) {
     memset(lastTime, 0, sizeof lastTime);
     negativePosition = INT_MAX;
     clockTicked = true;
-    repaint();
+    invalidate();
     iapp->relayout();
 }
 
@@ -214,7 +214,7 @@ void YClock::actionPerformed(YAction action, unsigned int modifiers) {
     else if (action == actionClockUTC) {
         clockUTC ^= true;
         clockTicked = true;
-        repaint();
+        invalidate();
     }
     else if (action == actionClockHM) {
         changeTimeFormat(" %H:%M ");
@@ -392,7 +392,7 @@ bool YClock::handleTimer(YTimer *t) {
     if (toolTipVisible())
         updateToolTip();
     clockTicked = true;
-    repaint();
+    invalidate();
     return true;
 }
 
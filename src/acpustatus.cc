@@ -390,7 +390,7 @@ void CPUStatus::updateStatus() {
     for (int i(1); i < taskBarCPUSamples; i++)
         cpu.copyTo(i, i - 1);
     getStatus();
-    repaint();
+    invalidate();
 }
 
 int CPUStatus::getAcpiTemp(char *tempbuf, int buflen) {
@@ -0,0 +1,123 @@
+/*
+ * IceWM
+ *
+ * Index of the executables in PATH for command completion.
+ */
+#include "config.h"
+#include "aexecindex.h"
+#include "mstring.h"
+#include "udir.h"
+#include "debug.h"
+
+#include <paths.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#ifndef _PATH_DEFPATH
+#define _PATH_DEFPATH "/bin:/usr/bin:/sbin:/usr/sbin"
+#endif
+
+// quote what the shell would interpret, as globit does
+static mstring escape(const std::string& name) {
+    std::string quoted;
+    quoted.reserve(2 * name.size());
+    for (char c : name) {
+        if (strchr("\t\n \"#$&'()*:;<=>?[\\`{|}", c))
+            quoted += '\\';
+        quoted += c;
+    }
+    return mstring(quoted.c_str(), quoted.size());
+}
+
+ExecIndex::ExecIndex() :
+    fWatch(this),
+    fStale(true)
+{
+}
+
+ExecIndex::~ExecIndex() {
+}
+
+void ExecIndex::handleFileChange(YFileWatch* watch) {
+    fStale = true;
+}
+
+void ExecIndex::scan(const char* folder) {
+    std::string path(folder);
+    path += '/';
+    const size_t length = path.size();
+    for (cdir dir(folder); dir.next(); ) {
+        const char* name = dir.entry();
+        if (*name == '.')
+            continue;
+        path.resize(length);
+        path += name;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+            (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+            fNames.push_back(name);
+    }
+}
+
+void ExecIndex::update() {
+    const char* env = getenv("PATH");
+    std::string search(env && *env ? env : _PATH_DEFPATH);
+    if (fStale == false && search == fPath)
+        return;
+
+    fNames.clear();
+    fWatch.clear();
+    fPath = search;
+    fStale = false;
+
+    for (size_t start = 0; start <= search.size(); ) {
+        size_t colon = search.find(':', start);
+        if (colon == std::string::npos)
+            colon = search.size();
+        std::string folder(search, start, colon - start);
+        if (folder.empty())
+            folder = ".";
+        if (folder[0] == '/')
+            fWatch.add(folder.c_str());
+        scan(folder.c_str());
+        start = colon + 1;
+    }
+
+    std::sort(fNames.begin(), fNames.end());
+    fNames.erase(std::unique(fNames.begin(), fNames.end()), fNames.end());
+    MSG(("indexed %d commands", int(fNames.size())));
+}
+
+int ExecIndex::complete(const char* prefix, mstring* best,
+                        MStringArray* list)
+{
+    update();
+
+    const std::string start(prefix);
+    auto first = std::lower_bound(fNames.begin(), fNames.end(), start);
+    auto last = first;
+    while (last != fNames.end() && last->compare(0, start.size(), start) == 0)
+        ++last;
+
+    const int count = int(last - first);
+    if (count == 0)
+        return 0;
+
+    if (list) {
+        for (auto it = first; it != last; ++it)
+            list->append(it->c_str());
+    }
+
+    // the range is sorted, so its ends have the shortest common prefix
+    const std::string& a = *first;
+    const std::string& b = *(last - 1);
+    size_t common = start.size();
+    while (common < a.size() && common < b.size() && a[common] == b[common])
+        ++common;
+    *best = escape(a.substr(0, common));
+    return count;
+}
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,43 @@
+#ifndef AEXECINDEX_H
+#define AEXECINDEX_H
+
+#include "yfilewatch.h"
+#include <string>
+#include <vector>
+
+class MStringArray;
+
+/*
+ * The names of the executables in the folders of PATH, sorted and
+ * without duplicates, for command completion in the address bar.
+ * The index is read when it is first needed and read again after
+ * one of the folders has changed or PATH has been modified.
+ */
+class ExecIndex: private YFileWatchListener {
+public:
+    ExecIndex();
+    ~ExecIndex();
+
+    // Like globit_best for a command name: return the number of
+    // commands which start with prefix, set best to the sole match
+    // or to their longest common prefix, and add them to list.
+    int complete(const char* prefix, mstring* best,
+                 MStringArray* list = nullptr);
+
+private:
+    void update();
+    void scan(const char* folder);
+    virtual void handleFileChange(YFileWatch* watch);
+
+    std::vector<std::string> fNames;
+    std::string fPath;      // PATH from which the index was made
+    YFileWatch fWatch;
+    bool fStale;
+
+    ExecIndex(const ExecIndex&);
+    ExecIndex& operator=(const ExecIndex&);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
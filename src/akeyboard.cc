@@ -40,7 +40,7 @@ void KeyboardStatus::updateKeyboard(mstring keyboard) {
         } else {
             fIcon = null;
         }
-        repaint();
+        invalidate();
         if (toolTipVisible())
             updateToolTip();
     }
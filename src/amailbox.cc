@@ -776,7 +776,7 @@ void MailBoxStatus::mailChecked(MailBoxState mst, long count, long unread) {
 
     if (mst != fState) {
         fState = mst;
-        repaint();
+        invalidate();
         if (fState == mbxHasNewMail)
             newMailArrived(count, unread);
     }
@@ -838,7 +838,7 @@ void MailBoxStatus::suspend(bool suspend) {
         if (suspend) {
             if (fState != mbxNoMail) {
                 fState = mbxNoMail;
-                repaint();
+                invalidate();
             }
         }
     }
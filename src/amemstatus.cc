@@ -188,7 +188,7 @@ void MEMStatus::updateStatus() {
         samples.copyTo(i, i - 1);
     }
     getStatus();
-    repaint();
+    invalidate();
 }
 
 unsigned long long MEMStatus::parseField(const char *buf, size_t bufLen,
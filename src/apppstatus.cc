@@ -495,7 +495,7 @@ void NetStatus::updateStatus(const char* sharedData) {
                  ppp_out[last] == ppp_out[last - 1]);
     unchanged = same ? 1 + unchanged : 0;
 
-    repaint();
+    invalidate();
 }
 
 
@@ -69,7 +69,7 @@ void TaskBarApp::setToolTip(const mstring& tip) {
 
 void TaskBarApp::repaint() {
     if (this == fButton->getActive()) {
-        fButton->repaint();
+        fButton->invalidate();
     }
 }
 
@@ -159,7 +159,7 @@ void TaskButton::addApp(TaskBarApp* tapp) {
     }
     fTaskPane->relayout();
     if (visible())
-        repaint();
+        invalidate();
 }
 
 void TaskButton::remove(TaskBarApp* tapp) {
@@ -177,7 +177,7 @@ void TaskButton::remove(TaskBarApp* tapp) {
     }
     else if (visible()) {
         if (getShown())
-            repaint();
+            invalidate();
         else
             fTaskPane->relayout();
         if (toolTipVisible())
@@ -204,7 +204,7 @@ void TaskButton::setShown(TaskBarApp* tapp, bool ashow) {
         }
         fTaskPane->relayout();
         if (visible() && gdraw)
-            repaint();
+            invalidate();
     }
     else if (tapp == fActive) {
         if (ashow != visible())
@@ -424,7 +424,7 @@ void TaskButton::paint(Graphics& g, const YRect& r) {
                      (wmLook == lookMetal)) / 2);
         iconX = p + max(1, left);
         iconY = p + 1 + y;
-        iconDrawn = icon->draw(g, iconX, iconY, iconSize);
+        iconDrawn = icon->draw(g, iconX, iconY, iconSize, this);
         if (iconDrawn && p + max(1, left) + iconSize + 5 >= int(width())) {
             if (bgGrad != null) {
                 g.maxOpacity();
@@ -735,7 +735,7 @@ bool TaskButton::handleTimer(YTimer* t) {
             if (fFlashStart + focusRequestFlashTime < monotime())
                 fFlashing = false;
         }
-        repaint();
+        invalidate();
         return fFlashing;
     }
     return false;
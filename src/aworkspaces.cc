@@ -46,6 +46,13 @@ void WorkspaceButton::repaint() {
     fGraphics.paint();
 }
 
+void WorkspaceButton::releaseBuffers() {
+    if (!fGraphics)
+        return;
+    fGraphics.release();
+    repaintOnShow();
+}
+
 void WorkspaceButton::handleButton(const XButtonEvent &button) {
     if (fDragging &&
         button.type == ButtonPress &&
@@ -514,7 +521,7 @@ bool WorkspacesPane::handleTimer(YTimer *t) {
                         wk->extent() > 0 &&
                         wk->x() < int(width()))
                     {
-                        wk->repaint();
+                        wk->invalidate();
                     }
                 }
             }
@@ -29,6 +29,7 @@ public:
     void setPosition(int x, int y);
     int extent() const { return x() + int(width()); }
     virtual void repaint();
+    virtual void releaseBuffers();
     static void freeFonts() { normalButtonFont = null; activeButtonFont = null; }
 
 private:
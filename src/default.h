@@ -123,6 +123,7 @@ XIV(bool, centerMaximizedWindows,               false)
 XIV(bool, hideBordersMaximized,                 false)
 XIV(bool, win95keys,                            true)
 XIV(bool, autoReloadMenus,                      true)
+XIV(bool, prefetchMenuProgs,                    true)
 XIV(bool, arrangeWindowsOnScreenSizeChange,     true)
 XIV(bool, clientMouseActions,                   true)
 XIV(bool, showPrograms,                         false)
@@ -300,6 +301,7 @@ cfoption icewm_preferences[] = {
     OBV("VerticalEdgeSwitch",                   &edgeVertWorkspaceSwitching,    "Workspace switches by moving mouse to top/bottom screen edge"),
     OBV("ContinuousEdgeSwitch",                 &edgeContWorkspaceSwitching,    "Workspace switches continuously when moving mouse to screen edge"),
     OBV("AutoReloadMenus",                      &autoReloadMenus,               "Reload menu files automatically"),
+    OBV("PrefetchMenuProgs",                    &prefetchMenuProgs,             "Run menuprog commands in the background before their menu is opened"),
     OBV("ArrangeWindowsOnScreenSizeChange",     &arrangeWindowsOnScreenSizeChange, "Automatically arrange windows when screen size changes"),
     OBV("ShowTaskBar",                          &showTaskBar,                   "Show task bar"),
     OBV("TaskBarAtTop",                         &taskBarAtTop,                  "Task bar at top of the screen"),
@@ -426,6 +428,8 @@ cfoption icewm_preferences[] = {
     OIV("TaskBarGroupingStyle",                 &taskBarGroupingStyle, 0, 1,    "How to show how many grouped windows are under the tab. (0=dots, 1=digits)"),
 ///    OSV("Theme",                                &themeName,                     "Theme name"),
     OSV("IconPath",                             &iconPath,                      "Icon search path (colon separated)"),
+    OIV("IconCacheSize",                        &iconCacheSize, 0, 1048576,     "Kilobytes of icon images to keep for icons which are no longer in use"),
+    OIV("IconLoadThreads",                      &iconLoadThreads, 0, 16,        "Threads which decode icons for menus and task buttons in the background, 0 to decode while painting"),
     OSV("IconThemes",                           &iconThemes,                    "Colon separated icon theme list with wildcard support. Minus prefix - can be used to exclude themes."),
     OSV("MailBoxPath",                          &mailBoxPath,                   "Colon separated paths of your mailboxes, otherwise $MAILPATH or $MAIL is used"),
     OSV("MailCommand",                          &mailCommand,                   "Command to run on mailbox"),
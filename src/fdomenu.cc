@@ -36,9 +36,11 @@ typedef const char* LPCSTR;
 #include <glib/gstdio.h>
 #include <gio/gdesktopappinfo.h>
 #include "ycollections.h"
+#include "ycachefile.h"
 
 // program options
 bool add_sep_before(false), add_sep_after(false), no_sep_others(false), no_sub_cats(false);
+bool benchmark(false);
 
 template<typename T, void TFreeFunc(T)>
 struct auto_raii {
@@ -108,6 +110,7 @@ public:
     struct t_print_meta {
         int count, level;
         t_menu_node* print_separated;
+        FILE* out;
     };
     static gboolean print_node(gpointer key, gpointer value, gpointer pr_meta) {
         ((t_menu_node*) value)->print((t_print_meta*) pr_meta);
@@ -122,8 +125,8 @@ public:
         {
             if(title && progCmd) {
                 if(ctx->count == 0 && add_sep_before)
-                    puts("separator");
-                printf("prog \"%s\" %s %s\n",
+                    fputs("separator\n", ctx->out);
+                fprintf(ctx->out, "prog \"%s\" %s %s\n",
                         title,
                         meta->icon,
                         progCmd);
@@ -144,35 +147,35 @@ public:
         // root level does not have a name, for others open category menu
         if (ctx->level > 0) {
             if (ctx->count == 0 && add_sep_before)
-                puts("separator");
+                fputs("separator\n", ctx->out);
             ctx->count++;
-            printf("menu \"%s\" %s {\n", title, meta->icon);
+            fprintf(ctx->out, "menu \"%s\" %s {\n", title, meta->icon);
         }
         ctx->level++;
         g_tree_foreach(store, print_node, ctx);
         if(ctx->level == 1 && ctx->print_separated)
         {
-            puts("separator");
+            fputs("separator\n", ctx->out);
             no_sep_others = true;
             ctx->print_separated->print(ctx);
         }
         ctx->level--;
         if (ctx->level > 0)
 #ifndef DEBUG
-            puts("}");
+            fputs("}\n", ctx->out);
 #else
-            printf("# end of menu \"%s\"\n}\n", title);
+            fprintf(ctx->out, "# end of menu \"%s\"\n}\n", title);
 #endif
         if(add_sep_after && ctx->level == 0 && ctx->count > 0)
-            puts("separator");
+            fputs("separator\n", ctx->out);
 
     }
 
     /**
      * Usual print method for the root node
      */
-    void print() {
-        t_print_meta ctx = {0,0,nullptr};
+    void print(FILE* out) {
+        t_print_meta ctx = {0,0,nullptr,out};
         print(&ctx);
     }
 
@@ -524,8 +527,16 @@ void pickup_folder_info(LPCSTR szDesktopFile) {
     }
 }
 
-void insert_app_info(const char* szDesktopFile) {
-    tDesktopInfo dinfo(szDesktopFile);
+// one desktop file, parsed by a worker thread and inserted in order
+struct tParsedApp {
+    LPCSTR d_file;
+    t_menu_node_app* node;
+    gchar** cats;
+};
+
+static void parse_app_info(gpointer data, gpointer) {
+    tParsedApp* app = (tParsedApp*) data;
+    tDesktopInfo dinfo(app->d_file);
     if (!dinfo.pInfo)
         return;
 
@@ -535,13 +546,37 @@ void insert_app_info(const char* szDesktopFile) {
     if (0 == strncmp(pCats, "X-", 2))
         return;
 
-    t_menu_node* pNode = new t_menu_node_app(dinfo);
+    app->node = new t_menu_node_app(dinfo);
+    app->cats = g_strsplit(pCats, ";", -1);
+}
+
+void insert_app_info(tParsedApp* app) {
+    if (!app->node)
+        return;
     // Pigeonholing roughly by guessed menu structure
+    root.add_by_categories(app->node, app->cats);
+    g_strfreev(app->cats);
+}
 
-    gchar **ppCats = g_strsplit(pCats, ";", -1);
-    root.add_by_categories(pNode, ppCats);
-    g_strfreev(ppCats);
+// The scanned files and folders with their sizes and modification times.
+// The menu cache is valid as long as they are the same.
+static guint64 scan_stamp = fnvOffset;
+static unsigned scan_count;
 
+static void stamp_bytes(guint64& hash, gconstpointer data, gsize len) {
+    hash = fnvHash(hash, data, len);
+}
+
+static void stamp_string(guint64& hash, LPCSTR str) {
+    hash = fnvHash(hash, str);
+}
+
+static void stamp_file(LPCSTR name, const GStatBuf& st) {
+    gint64 values[] = { gint64(st.st_mtime), gint64(st.st_size),
+                        gint64(st.st_ino) };
+    stamp_string(scan_stamp, name);
+    stamp_bytes(scan_stamp, values, sizeof values);
+    ++scan_count;
 }
 
 void proc_dir_rec(LPCSTR syspath, unsigned depth,
@@ -564,6 +599,7 @@ void proc_dir_rec(LPCSTR syspath, unsigned depth,
         static GStatBuf buf;
         if (0 != g_stat(szFullName, &buf))
             continue;
+        stamp_file(szFullName, buf);
         if (S_ISDIR(buf.st_mode)) {
             static ino_t reclog[6];
             for (unsigned i = 0; i < depth; ++i) {
@@ -638,6 +674,7 @@ static void help(LPCSTR home, LPCSTR dirs, FILE* out, int xit) {
             "--sep-after\tPrint separator only after contents\n"
             "--no-sep-others\tNo separation of the 'Others' menu point\n"
             "--no-sub-cats\tNo additional subcategories, just one level of menues\n"
+            "--benchmark\tIgnore the menu cache and report timings on stderr\n"
             "*.desktop\tAny .desktop file to launch the application command from there\n"
             "This program also listens to "
                     "environment variables defined by the\nXDG Base Directory Specification:\n"
@@ -652,24 +689,134 @@ void split_folders(const char* path_string, tCharVec& where) {
     }
 }
 
-void process_apps(const tCharVec& where) {
+static tCharVec app_files, dir_files;
+
+static void collect_app_file(LPCSTR szDesktopFile) {
+    app_files.add(g_strdup(szDesktopFile));
+}
+
+static void collect_dir_file(LPCSTR szDesktopFile) {
+    dir_files.add(g_strdup(szDesktopFile));
+}
+
+void scan_apps(const tCharVec& where) {
     for (const gchar* const * p = where.data; p < where.data + where.size;
             ++p) {
-        proc_dir_rec(*p, 0, insert_app_info, "applications", "desktop");
+        proc_dir_rec(*p, 0, collect_app_file, "applications", "desktop");
     }
 }
 
-/**
- * @return True if all categories received description data
- */
-void load_folder_descriptions(const tCharVec& where) {
+void scan_folder_descriptions(const tCharVec& where) {
     for (const gchar* const * p = where.data; p < where.data + where.size;
             ++p) {
-        proc_dir_rec(*p, 0, pickup_folder_info, "desktop-directories",
+        proc_dir_rec(*p, 0, collect_dir_file, "desktop-directories",
                 "directory");
     }
 }
 
+/**
+ * Parse the desktop files on a pool of threads, then insert them
+ * into the menu in the order in which they were found.
+ */
+static unsigned process_apps() {
+    tParsedApp* apps = new tParsedApp[app_files.size];
+    for (unsigned i = 0; i < app_files.size; ++i)
+        apps[i] = tParsedApp { app_files.data[i], nullptr, nullptr };
+
+    unsigned threads = 1;
+#if GLIB_CHECK_VERSION(2,36,0)
+    threads = g_get_num_processors();
+#endif
+    threads = MIN(MIN(threads, 8U), unsigned(app_files.size / 16));
+
+    GThreadPool* pool = nullptr;
+    if (threads > 1)
+        pool = g_thread_pool_new(parse_app_info, nullptr, threads, TRUE,
+                                 nullptr);
+    for (unsigned i = 0; i < app_files.size; ++i) {
+        if (pool)
+            g_thread_pool_push(pool, &apps[i], nullptr);
+        else
+            parse_app_info(&apps[i], nullptr);
+    }
+    if (pool)
+        g_thread_pool_free(pool, FALSE, TRUE);
+
+    for (unsigned i = 0; i < app_files.size; ++i)
+        insert_app_info(&apps[i]);
+    delete[] apps;
+    return pool ? threads : 1;
+}
+
+/**
+ * @return True if all categories received description data
+ */
+void load_folder_descriptions() {
+    for (unsigned i = 0; i < dir_files.size; ++i)
+        pickup_folder_info(dir_files.data[i]);
+}
+
+// The cache file is named after everything which influences the output
+// except the desktop files, and it starts with a comment line which
+// holds the stamp of the scanned files.
+static gchar* cache_file_name(LPCSTR usershare, LPCSTR sysshare) {
+    guint64 hash = fnvOffset;
+    bool options[] = { add_sep_before, add_sep_after,
+                       no_sep_others, no_sub_cats };
+    stamp_bytes(hash, options, sizeof options);
+    LPCSTR values[] = { VERSION, ApplicationName, usershare, sysshare,
+        getenv("LANGUAGE"), getenv("LC_ALL"), getenv("LC_MESSAGES"),
+        getenv("LANG"), getenv("XDG_CURRENT_DESKTOP"),
+    };
+    for (LPCSTR value : values)
+        stamp_string(hash, value);
+
+    gchar name[40];
+    g_snprintf(name, sizeof name, "menu-fdo-%016" G_GINT64_MODIFIER "x",
+               hash);
+    return g_build_filename(g_get_user_cache_dir(), "icewm", name, NULL);
+}
+
+static void cache_header(gchar* buf, gsize size) {
+    g_snprintf(buf, size, "# icewm-menu-fdo %016" G_GINT64_MODIFIER "x\n",
+               scan_stamp);
+}
+
+static bool print_cached_menu(LPCSTR cache) {
+    gchar* data = nullptr;
+    gsize length = 0;
+    if (!g_file_get_contents(cache, &data, &length, nullptr))
+        return false;
+    auto_gfree free_data(data);
+
+    gchar header[64];
+    cache_header(header, sizeof header);
+    gsize len = strlen(header);
+    if (length < len || strncmp(data, header, len))
+        return false;
+    fwrite(data + len, 1, length - len, stdout);
+    return true;
+}
+
+static void save_cached_menu(LPCSTR cache, LPCSTR menu, gsize length) {
+    gchar header[64];
+    cache_header(header, sizeof header);
+    gchar* data = g_strconcat(header, menu, NULL);
+    auto_gfree free_data(data);
+
+    gchar* dir = g_path_get_dirname(cache);
+    auto_gfree free_dir(dir);
+    if (g_mkdir_with_parents(dir, 0700) == 0)
+        g_file_set_contents(cache, data, strlen(header) + length, nullptr);
+}
+
+static double elapsed_ms(gint64& start) {
+    gint64 now = g_get_monotonic_time();
+    double ms = (now - start) / 1e3;
+    start = now;
+    return ms;
+}
+
 #ifdef DEBUG_xxx
 void dbgPrint(const gchar *msg)
 {
@@ -732,6 +879,10 @@ int main(int argc, LPCSTR *argv) {
             no_sub_cats = true;
             continue;
         }
+        if (is_long_switch(*pArg, "benchmark")) {
+            benchmark = true;
+            continue;
+        }
         // unknown option?
         help(usershare, sysshare, stderr, EXIT_FAILURE);
     }
@@ -740,13 +891,45 @@ int main(int argc, LPCSTR *argv) {
     split_folders(sysshare, sys_folders);
     split_folders(usershare, home_folders);
 
-    load_folder_descriptions(sys_folders);
-    load_folder_descriptions(home_folders);
+    gint64 start = g_get_monotonic_time();
+    scan_folder_descriptions(sys_folders);
+    scan_folder_descriptions(home_folders);
+    scan_apps(sys_folders);
+    scan_apps(home_folders);
+    double scan_ms = elapsed_ms(start);
+
+    gchar* cache = cache_file_name(usershare, sysshare);
+    auto_gfree free_cache(cache);
+    if (!benchmark && print_cached_menu(cache))
+        return EXIT_SUCCESS;
 
-    process_apps(sys_folders);
-    process_apps(home_folders);
+    load_folder_descriptions();
+    unsigned threads = process_apps();
+    double parse_ms = elapsed_ms(start);
 
-    root.print();
+    char* menu = nullptr;
+    size_t length = 0;
+    FILE* out = open_memstream(&menu, &length);
+    if (out == nullptr) {
+        root.print(stdout);
+        return EXIT_SUCCESS;
+    }
+    root.print(out);
+    fclose(out);
+    fwrite(menu, 1, length, stdout);
+    double emit_ms = elapsed_ms(start);
+
+    save_cached_menu(cache, menu, length);
+    free(menu);
+
+    if (benchmark) {
+        fflush(stdout);
+        fprintf(stderr, "%s: %u desktop files, %u entries scanned: "
+                "scan %.1f ms, parse %.1f ms on %u threads, "
+                "emit %.1f ms, %lu bytes\n",
+                ApplicationName, unsigned(app_files.size), scan_count,
+                scan_ms, parse_ms, threads, emit_ms, (unsigned long) length);
+    }
 
     return EXIT_SUCCESS;
 }
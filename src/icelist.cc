@@ -137,9 +137,9 @@ public:
     ~ObjectList() {
         winCount--;
 
-        while (list->getItem(0)) {
+        for (int i = list->getItemCount(); --i >= 0; ) {
             ObjectListItem* item =
-                static_cast<ObjectListItem *>(list->getItem(0));
+                static_cast<ObjectListItem *>(list->getItem(i));
             list->removeItem(item);
             delete item;
         }
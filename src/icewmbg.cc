@@ -27,9 +27,11 @@ private:
     mstring name;
     Pixmap pix;
     time_t last, check;
+    unsigned hintWidth, hintHeight;
 public:
     explicit PixFile(mstring file, Pixmap pixmap = null)
-        : name(file), pix(pixmap), last(0L), check(0L)
+        : name(file), pix(pixmap), last(0L), check(0L),
+          hintWidth(0), hintHeight(0)
     {
     }
     ~PixFile() {
@@ -37,8 +39,15 @@ public:
         pix = null;
     }
     mstring file() const { return name; }
-    Pixmap pixmap(Paths paths) {
+    // A nonzero width and height permit loading a reduced image.
+    Pixmap pixmap(Paths paths, unsigned width, unsigned height) {
         time_t now = time(nullptr);
+        if (width != hintWidth || height != hintHeight) {
+            if (last)
+                unload();
+            hintWidth = width;
+            hintHeight = height;
+        }
         if (pix == null) {
             if (last == 0 || last + 2 < now) {
                 pix = load(paths);
@@ -65,10 +74,10 @@ public:
         Pixmap image;
         upath path(name);
         if (false == path.isAbsolute()) {
-            image = paths->loadPixmap(null, path);
+            image = paths->loadPixmap(null, path, hintWidth, hintHeight);
         }
         if (image == null) {
-            image = YPixmap::load(path);
+            image = YPixmap::load(path, hintWidth, hintHeight);
         }
         if (image == null) {
             tlog(_("Failed to load image '%s'."), name.c_str());
@@ -112,9 +121,9 @@ public:
             pixes.append(new PixFile(file, pixmap));
         }
     }
-    Pixmap get(mstring name) {
+    Pixmap get(mstring name, unsigned width, unsigned height) {
         int k = find(name);
-        return k == -1 ? null : pixes[k]->pixmap(getPaths());
+        return k == -1 ? null : pixes[k]->pixmap(getPaths(), width, height);
     }
     void clear() {
         pixes.clear();
@@ -193,6 +202,10 @@ private:
     YColor getBackgroundColor();
     ref<YPixmap> getTransparencyPixmap();
     YColor getTransparencyColor();
+    // Scaled or centered images need no more pixels than the desktop.
+    bool reducible() const { return scaleBackground || centerBackground; }
+    unsigned hintWidth() const { return reducible() ? desktopWidth : 0; }
+    unsigned hintHeight() const { return reducible() ? desktopHeight : 0; }
     Atom atom(const char* name) const;
     static Window window() { return desktop->handle(); }
     upath getThemeDir();
@@ -471,7 +484,7 @@ ref<YPixmap> Background::getBackgroundPixmap() {
     if (count > 0 && activeWorkspace >= 0) {
         for (int i = 0; i < count; ++i) {
             int k = shuffle((i + activeWorkspace + cycleOffset) % count);
-            pixmap = cache.get(backgroundImages[k]);
+            pixmap = cache.get(backgroundImages[k], hintWidth(), hintHeight());
             if (pixmap != null) {
                 pixmapName = backgroundImages[k];
                 break;
@@ -495,7 +508,7 @@ ref<YPixmap> Background::getTransparencyPixmap() {
     if (count > 0 && numbg > 0 && activeWorkspace >= 0) {
         for (int i = 0; i < count; ++i) {
             int k = shuffle((i + activeWorkspace + cycleOffset) % numbg) % count;
-            pixmap = cache.get(transparencyImages[k]);
+            pixmap = cache.get(transparencyImages[k], hintWidth(), hintHeight());
             if (pixmap != null)
                 break;
         }
@@ -0,0 +1,58 @@
+/*
+ *  Measure the time to lay out a menu with many items,
+ *  first with cold font caches and then repeatedly.
+ */
+#include "config.h"
+#include "ymenu.h"
+#include "ymenuitem.h"
+#include "yaction.h"
+#include "ylocale.h"
+#include "yxapp.h"
+#include "ytime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const char *ApplicationName = "testmenulayout";
+
+static const char* words[] = {
+    "Accessories", "Calculator", "Terminal", "Editor", "Viewer",
+    "Graphics", "Internet", "Browser", "Office", "Spreadsheet",
+    "Settings", "Sound & Video", "Player", "System Monitor", "Files",
+    "Développement", "Éditeur", "Übersicht", "Größe", "Настройки",
+};
+
+static double layout(YMenu* menu, int rounds) {
+    timeval start = monotime();
+    for (int i = 0; i < rounds; ++i)
+        menu->sizePopup(0);
+    return 1e3 * toDouble(monotime() - start) / rounds;
+}
+
+int main(int argc, char **argv) {
+    YLocale locale;
+    YXApplication xapp(&argc, &argv);
+
+    int count = 1000;
+    if (1 < argc)
+        count = max(1, atoi(argv[1]));
+
+    YMenu* menu = new YMenu();
+    const int nwords = int ACOUNT(words);
+    for (int i = 0; i < count; ++i) {
+        char name[100], param[20];
+        snprintf(name, sizeof name, "%s %s %d",
+                 words[i % nwords], words[(i / nwords) % nwords], i);
+        snprintf(param, sizeof param, "Ctrl+%d", i % 10);
+        menu->addItem(name, 0, param, YAction());
+    }
+
+    double cold = layout(menu, 1);
+    double warm = layout(menu, 10);
+    printf("%d menu items: first layout %.3f ms, next layouts %.3f ms\n",
+           count, cold, warm);
+
+    delete menu;
+    return 0;
+}
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,230 @@
+/*
+ *  Compare the fixed-point image scaler with the floating-point
+ *  upscaling which YXImage used before, and with a reference area
+ *  average in integers. Results must agree within one per channel.
+ *  Optional arguments give a source size: testscale 3840 2160
+ */
+#include "config.h"
+#include "base.h"
+#include "yscale.h"
+#include "ytime.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *ApplicationName = "testscale";
+
+static const unsigned Byte = 0xFF;
+
+// The former YXImage::upscale, without the final alpha adjustment.
+static void upscaleDouble(const uint32_t* src, unsigned w, unsigned h,
+                          uint32_t* dst, unsigned nw, unsigned nh)
+{
+    double* chanls = (double *) calloc(nw * nh, 4 * sizeof(double));
+    double* counts = (double *) calloc(nw * nh, sizeof(double));
+
+    double pppx = (double) w / (double) nw;
+    double pppy = (double) h / (double) nh;
+
+    double ty, by; unsigned l;
+    for (ty = 0.0, by = pppy, l = 0; l < nh; l++, ty += pppy, by += pppy) {
+        for (unsigned j = floor(ty); j < by; j++) {
+            double yf = 1.0;
+            if (ty < (j + 1) && (j + 1) < by)
+                yf = (j + 1) - ty;
+            else if (ty < j && j < by)
+                yf = by - j;
+            double lx, rx; unsigned k;
+            for (lx = 0.0, rx = pppx, k = 0; k < nw; k++, lx += pppx, rx += pppx) {
+                for (unsigned i = floor(lx); i < rx; i++) {
+                    double xf = 1.0;
+                    if (lx < (i + 1) && (i + 1) < rx)
+                        xf = (i + 1) - lx;
+                    else if (lx < i && i < rx)
+                        xf = rx - i;
+                    double ff = xf * yf;
+                    unsigned m = l * nw + k;
+                    uint32_t pixel = src[j * w + i];
+                    counts[m] += ff;
+                    for (int c = 0; c < 4; ++c)
+                        chanls[4 * m + c] += ((pixel >> (8 * c)) & Byte) * ff;
+                }
+            }
+        }
+    }
+    for (unsigned m = 0; m < nw * nh; ++m) {
+        uint32_t pixel = 0;
+        for (int c = 0; c < 4 && counts[m]; ++c)
+            pixel |= uint32_t(lround(chanls[4 * m + c] / counts[m]) & Byte)
+                     << (8 * c);
+        dst[m] = pixel;
+    }
+    free(chanls);
+    free(counts);
+}
+
+// A reference downscaler in 10-bit fixed point. Each source pixel is
+// weighted by how much of it falls into each destination pixel, and
+// the sums are cleared after a destination row is complete.
+static void downscaleInteger(const uint32_t* src, unsigned oldWidth,
+                             unsigned oldHeight, uint32_t* dst,
+                             unsigned newWidth, unsigned newHeight)
+{
+    const unsigned shift = 10;
+    unsigned long (*acc)[4] = new unsigned long[newWidth][4];
+    unsigned long *div = new unsigned long[newWidth];
+    memset(acc, 0, sizeof(*acc) * newWidth);
+    memset(div, 0, sizeof(*div) * newWidth);
+
+    unsigned hacc = 0;
+    unsigned h = 0;
+    unsigned mult = 0;
+    bool repeat = false;
+
+    for (unsigned y = 0; y < oldHeight; y = repeat ? y : 1 + y) {
+        if (repeat) {
+            repeat = false;
+            mult = (1 << shift) - mult;
+        }
+        else {
+            hacc += newHeight;
+            if (hacc <= oldHeight)
+                mult = 1 << shift;
+            else
+                mult = ((newHeight / 2) + (1 << shift)
+                     * (newHeight - (hacc - oldHeight))) / newHeight;
+        }
+
+        unsigned wacc = 0;
+        unsigned w = 0;
+        for (unsigned x = 0; x < oldWidth; ++x) {
+            uint32_t pixel = src[y * oldWidth + x];
+            wacc += newWidth;
+            unsigned m = 1 << shift;
+            if (wacc >= oldWidth)
+                m = (newWidth / 2 + (1 << shift)
+                  * (newWidth - (wacc - oldWidth))) / newWidth;
+            for (int c = 0; c < 4; ++c)
+                acc[w][c] += m * mult * ((pixel >> (8 * c)) & Byte);
+            div[w] += m * mult;
+            if (wacc >= oldWidth) {
+                ++w;
+                wacc -= oldWidth;
+                if (wacc > 0) {
+                    m = (1 << shift) - m;
+                    for (int c = 0; c < 4; ++c)
+                        acc[w][c] += m * mult * ((pixel >> (8 * c)) & Byte);
+                    div[w] += m * mult;
+                }
+            }
+        }
+
+        if (hacc >= oldHeight) {
+            hacc -= oldHeight;
+            if (hacc > 0)
+                repeat = true;
+            for (unsigned k = 0; k < newWidth; ++k) {
+                unsigned long d = non_zero(div[k]);
+                uint32_t pixel = 0;
+                for (int c = 0; c < 4; ++c)
+                    pixel |= uint32_t(acc[k][c] / d) << (8 * c);
+                dst[h * newWidth + k] = pixel;
+            }
+            ++h;
+            memset(acc, 0, sizeof(*acc) * newWidth);
+            memset(div, 0, sizeof(*div) * newWidth);
+        }
+    }
+    delete[] acc;
+    delete[] div;
+}
+
+static int difference(const uint32_t* a, const uint32_t* b, unsigned n) {
+    int most = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            int d = int((a[i] >> (8 * c)) & Byte) - int((b[i] >> (8 * c)) & Byte);
+            most = max(most, abs(d));
+        }
+    }
+    return most;
+}
+
+static double since(timeval start) {
+    return 1e3 * toDouble(monotime() - start);
+}
+
+static int failures;
+
+static void compare(const uint32_t* src, unsigned w, unsigned h,
+                    unsigned nw, unsigned nh)
+{
+    uint32_t* old = new uint32_t[nw * nh];
+    uint32_t* now = new uint32_t[nw * nh];
+    bool up = (nw > w || nh > h);
+
+    timeval start = monotime();
+    if (up)
+        upscaleDouble(src, w, h, old, nw, nh);
+    else
+        downscaleInteger(src, w, h, old, nw, nh);
+    printf("%4ux%-4u -> %4ux%-4u %-7s %8.2f ms",
+           w, h, nw, nh, up ? "double" : "integer", since(start));
+
+    for (int k = YScaler::Scalar; k <= YScaler::AVX2; ++k) {
+        YScaler::Kernel kernel = YScaler::Kernel(k);
+        if (YScaler::select(kernel)) {
+            start = monotime();
+            YScaler::scale(src, w, h, w, now, nw, nh, nw);
+            double ms = since(start);
+            int diff = difference(old, now, nw * nh);
+            printf("  %s %7.2f ms (%d)", YScaler::name(kernel), ms, diff);
+            if (diff > 1)
+                ++failures;
+        }
+    }
+    printf("\n");
+
+    static const char* const names[] = { "box", "bilinear", "lanczos" };
+    for (int f = YScaler::Bilinear; f <= YScaler::Lanczos; ++f) {
+        start = monotime();
+        YScaler::scale(src, w, h, w, now, nw, nh, nw, YScaler::Filter(f));
+        printf("%20s %-8s %8.2f ms\n", "", names[f], since(start));
+    }
+
+    delete[] old;
+    delete[] now;
+}
+
+int main(int argc, char **argv) {
+    unsigned w = argc > 2 ? atoi(argv[1]) : 1920;
+    unsigned h = argc > 2 ? atoi(argv[2]) : 1080;
+    YScaler::Kernel best = YScaler::kernel();
+
+    uint32_t* src = new uint32_t[w * h];
+    srand(1);
+    for (unsigned i = 0; i < w * h; ++i)
+        src[i] = uint32_t(rand()) ^ uint32_t(rand()) << 16;
+
+    compare(src, 48, 48, 16, 16);
+    compare(src, 48, 48, 20, 20);
+    compare(src, 16, 16, 48, 48);
+    compare(src, 32, 32, 48, 48);
+    compare(src, 37, 23, 64, 41);
+    compare(src, 50, 31, 33, 17);
+    compare(src, 1, 1, 5, 3);
+    compare(src, w, h, w / 2, h / 2);
+    compare(src, w, h, w * 2 / 3, h * 2 / 3);
+    compare(src, w, h, 1366, 768);
+    compare(src, w / 4, h / 4, w, h);
+
+    YScaler::select(best);
+    delete[] src;
+
+    if (failures)
+        printf("%d comparisons differ by more than one\n", failures);
+    return failures ? 1 : 0;
+}
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,100 @@
+/*
+ *  Measure the time from the request to start a program until the
+ *  program runs, for fork and exec as runProgram did before and for
+ *  YSpawn, while the parent has a large resident set like a window
+ *  manager with many pixmaps and icons. The child is echo, which
+ *  runs when its output arrives on a pipe.
+ *  Optional arguments: testspawn megabytes repetitions
+ */
+#include "config.h"
+#include "base.h"
+#include "yspawn.h"
+#include "ytime.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+const char *ApplicationName = "testspawn";
+
+static const char* const echo[] = { "echo", "x", nullptr };
+
+static int forkExec(int out) {
+    int pid = fork();
+    if (pid == 0) {
+        setsid();
+        dup2(out, 1);
+        close(out);
+        execvp(echo[0], const_cast<char **>(echo));
+        _exit(99);
+    }
+    return pid;
+}
+
+static int spawnExec(int out) {
+    YSpawn spawn;
+    spawn.newSession();
+    spawn.nullInput();
+    spawn.output(out);
+    return spawn.spawn(echo[0], echo, true);
+}
+
+// Start one child and return the milliseconds until it writes.
+static double measure(int (*start)(int)) {
+    int fds[2];
+    if (pipe(fds) == -1)
+        return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+    timeval begin = monotime();
+    int pid = start(fds[1]);
+    close(fds[1]);
+
+    char buf[8] = "";
+    ssize_t len = pid > 0 ? read(fds[0], buf, sizeof buf) : -1;
+    double ms = 1e3 * toDouble(monotime() - begin);
+    close(fds[0]);
+
+    int status = -1;
+    if (pid > 0)
+        waitpid(pid, &status, 0);
+    return (len == 2 && buf[0] == 'x' && status == 0) ? ms : -1;
+}
+
+static int run(const char* name, int (*start)(int), int count) {
+    double sum = 0, best = 1e9;
+    for (int i = 0; i < count; ++i) {
+        double ms = measure(start);
+        if (ms < 0) {
+            printf("%s: child failed\n", name);
+            return 1;
+        }
+        sum += ms;
+        best = min(best, ms);
+    }
+    printf("%-6s mean %7.3f ms, best %7.3f ms\n", name, sum / count, best);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t megabytes = argc > 1 ? size_t(atoi(argv[1])) : 64;
+    int count = argc > 2 ? max(1, atoi(argv[2])) : 20;
+
+    // a resident set which fork must map for the child
+    size_t size = megabytes << 20;
+    char* memory = static_cast<char *>(malloc(size));
+    if (memory)
+        memset(memory, 1, size);
+    printf("%zu MB resident, %d launches\n", memory ? megabytes : 0, count);
+
+    int failures = 0;
+    failures += run("fork", forkExec, count);
+    failures += run("spawn", spawnExec, count);
+
+    free(memory);
+    return failures ? 1 : 0;
+}
+
+// vim: set sw=4 ts=4 et:
@@ -48,23 +48,44 @@ void DTheme::open() {
     smActionListener->handleSMAction(ICEWM_ACTION_RESTARTWM);
 }
 
-ThemesMenu::ThemesMenu(IApp *app, YSMListener *smActionListener, YActionListener *wmActionListener, YWindow *parent): ObjectMenu(wmActionListener, parent) {
+ThemesMenu::ThemesMenu(IApp *app, YSMListener *smActionListener, YActionListener *wmActionListener, YWindow *parent):
+    ObjectMenu(wmActionListener, parent),
+    fWatch(this),
+    fStale(true)
+{
     this->app = app;
     this->smActionListener = smActionListener;
 }
 
 void ThemesMenu::updatePopup() {
-    refresh();
+    if (fStale)
+        refresh();
+}
+
+void ThemesMenu::handleFileChange(YFileWatch* watch) {
+    fStale = true;
+    if (visible() == false)
+        refresh();
 }
 
 void ThemesMenu::refresh() {
     removeAll();
+    fStale = false;
 
     mstring themes("/themes/");
     upath libThemes = YApplication::getLibDir() + themes;
     upath cnfThemes = YApplication::getConfigDir() + themes;
     upath prvThemes = YApplication::getPrivConfDir() + themes;
 
+    fWatch.clear();
+    if (autoReloadMenus) {
+        fWatch.add(libThemes);
+        fWatch.add(cnfThemes);
+        fWatch.add(prvThemes);
+    } else {
+        fStale = true;
+    }
+
     if (nestedThemeMenuMinNumber)
         themeCount =
             countThemes(libThemes) +
@@ -124,6 +145,8 @@ void ThemesMenu::findThemes(const upath& path, ObjectMenu* container) {
         YMenu* targetMenu = container;
         upath subdir = path + dir.entry();
         upath defThemePath = subdir + defTheme;
+        if (autoReloadMenus)
+            fWatch.add(subdir);
 
         if (defThemePath.isReadable()) {
             mstring relThemeName = dir.entry() + defTheme;
@@ -3,6 +3,7 @@
 
 #include "objmenu.h"
 #include "obj.h"
+#include "yfilewatch.h"
 
 class YMenu;
 class YSMListener;
@@ -19,7 +20,7 @@ private:
     mstring fTheme;
 };
 
-class ThemesMenu: public ObjectMenu {
+class ThemesMenu: public ObjectMenu, private YFileWatchListener {
 public:
     ThemesMenu(IApp *app, YSMListener *smActionListener, YActionListener *wmActionListener, YWindow *parent = nullptr);
     virtual ~ThemesMenu();
@@ -28,6 +29,11 @@ public:
     virtual void refresh();
 
 private:
+    // the theme folders and their subfolders are watched for changes
+    virtual void handleFileChange(YFileWatch* watch);
+    YFileWatch fWatch;
+    bool fStale;
+
     void findThemes(const upath& path, ObjectMenu* container);
 
     YMenuItem *newThemeItem(
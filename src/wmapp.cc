@@ -527,6 +527,13 @@ bool YWMApp::handleTimer(YTimer *timer) {
     return false;
 }
 
+void YWMApp::handleFileChange(YFileWatch* watch) {
+    if (watch == &keysWatch)
+        actionPerformed(actionReloadKeys, 0);
+    else if (watch == &optionsWatch)
+        actionPerformed(actionWinOptions, 0);
+}
+
 int YWMApp::handleError(XErrorEvent *xev) {
 
     if (initializing &&
@@ -718,17 +725,12 @@ bool YWMApp::mapClientByResource(const char* resource, long *pid) {
     if (isEmpty(resource))
         return false;
 
-    Window win(manager->findWindow(resource));
-    if (win) {
-        YFrameWindow* frame(manager->findFrame(win));
-        if (frame) {
-            frame->setWorkspace(manager->activeWorkspace());
-            frame->activateWindow(true);
-            frame->client()->getNetWMPid(pid);
-        }
-        else {
-            XMapRaised(xapp->display(), win);
-        }
+    YFrameClient* client(YFrameClient::findClass(resource));
+    if (client) {
+        YFrameWindow* frame(client->getFrame());
+        frame->setWorkspace(manager->activeWorkspace());
+        frame->activateWindow(true);
+        client->getNetWMPid(pid);
         return true;
     }
     return false;
@@ -1095,6 +1097,8 @@ YWMApp::YWMApp(int *argc, char ***argv, const char *displayName,
     errorRequestCode(0),
     errorFrame(nullptr),
     splashWindow(splash(splashFile)),
+    keysWatch(this),
+    optionsWatch(this),
     focusMode(loadFocusMode()),
     managerWindow(None)
 {
@@ -1128,6 +1132,10 @@ YWMApp::YWMApp(int *argc, char ***argv, const char *displayName,
 
     actionPerformed(actionWinOptions, 0);
     actionPerformed(actionReloadKeys, 0);
+    if (autoReloadMenus) {
+        keysWatch.addConfig("keys");
+        optionsWatch.addConfig("winoptions");
+    }
 
     initPointers();
 
@@ -1330,7 +1338,11 @@ bool YWMApp::handleIdle() {
     else if (taskBar) {
         taskBar->relayoutNow();
     }
-    return busy;
+
+    // the relayout may have invalidated windows after the first flush
+    if (YWindow::flushInvalid())
+        XFlush(display());
+    return busy || YWindow::invalidPending();
 }
 
 void YWMApp::signalGuiEvent(GUIEvent ge) {
@@ -4,6 +4,7 @@
 #include "ysmapp.h"
 #include "ymsgbox.h"
 #include "guievent.h"
+#include "yfilewatch.h"
 
 class YWindowManager;
 class AboutDlg;
@@ -38,7 +39,8 @@ class YWMApp:
     public YActionListener,
     public YMsgBoxListener,
     public YSMListener,
-    public YTimerListener
+    public YTimerListener,
+    private YFileWatchListener
 {
     typedef YSMApplication super;
 
@@ -129,10 +131,13 @@ private:
     lazy<YTimer> splashTimer;
     lazy<YWindow> splashWindow;
     lazy<GuiSignaler> guiSignaler;
+    YFileWatch keysWatch;
+    YFileWatch optionsWatch;
 
     void createTaskBar();
     YWindow* splash(const char* splashFile);
     virtual bool handleTimer(YTimer *timer);
+    virtual void handleFileChange(YFileWatch* watch);
     virtual int handleError(XErrorEvent *xev);
     void runRestart(const char *path, char *const *args);
 
@@ -16,6 +16,15 @@
 #include "yxcontext.h"
 #include "workspaces.h"
 #include "wmminiicon.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The clients by the resources which match their class hint:
+// "name", ".class" and "name.class".
+typedef std::unordered_map<std::string, std::vector<YFrameClient*>> ClassMap;
+static ClassMap classIndex;
 
 bool operator==(const XSizeHints& a, const XSizeHints& b) {
     long mask = PMinSize | PMaxSize | PResizeInc |
@@ -99,6 +108,8 @@ YFrameClient::YFrameClient(YWindow *parent, YFrameWindow *frame, Window win,
 }
 
 YFrameClient::~YFrameClient() {
+    indexClass(false);
+
     if (getFrame()) {
         frameContext.remove(handle());
     }
@@ -184,8 +195,70 @@ void YFrameClient::getClassHint() {
     if (!prop.wm_class)
         return;
 
+    indexClass(false);
     fClassHint.reset();
     XGetClassHint(xapp->display(), handle(), &fClassHint);
+    indexClass(true);
+}
+
+void YFrameClient::indexClass(bool insert) {
+    const char* name = fClassHint.res_name;
+    const char* klas = fClassHint.res_class ? fClassHint.res_class : "";
+    std::string keys[3];
+    int count = 0;
+    keys[count++] = std::string(".") + klas;
+    // a resource which starts with a dot matches only the class
+    if (nonempty(name) && *name != '.') {
+        keys[count++] = name;
+        keys[count++] = std::string(name) + "." + klas;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (insert) {
+            classIndex[keys[i]].push_back(this);
+        }
+        else {
+            ClassMap::iterator it = classIndex.find(keys[i]);
+            if (it != classIndex.end()) {
+                std::vector<YFrameClient*>& list = it->second;
+                auto self = std::find(list.begin(), list.end(), this);
+                if (self != list.end())
+                    list.erase(self);
+                if (list.empty())
+                    classIndex.erase(it);
+            }
+        }
+    }
+}
+
+YFrameClient* YFrameClient::findClass(const char* resource) {
+    if (isEmpty(resource))
+        return nullptr;
+
+    ClassMap::const_iterator it = classIndex.find(resource);
+    if (it == classIndex.end())
+        return nullptr;
+
+    YFrameClient* found = nullptr;
+    int count = 0;
+    for (YFrameClient* cli : it->second) {
+        if (cli->getFrame() && cli->adopted() && !cli->destroyed()) {
+            found = cli;
+            ++count;
+        }
+    }
+
+    // several candidates: take the last in the focus order
+    if (count > 1) {
+        const std::vector<YFrameClient*>& list = it->second;
+        for (YFrameIter iter = manager->focusedReverseIterator(); ++iter; ) {
+            YFrameClient* cli = iter->client();
+            if (cli && cli->adopted() && !cli->destroyed() &&
+                std::find(list.begin(), list.end(), cli) != list.end())
+                return cli;
+        }
+    }
+    return found;
 }
 
 void YFrameClient::getTransient() {
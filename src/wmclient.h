@@ -239,6 +239,11 @@ public:
     void getClassHint();
     ClassHint* classHint() { return &fClassHint; }
 
+    // The framed client whose class hint matches resource, as for
+    // ClassHint::match, preferring the one which was focused last.
+    // This uses an index of the class hints and queries no server.
+    static YFrameClient* findClass(const char* resource);
+
     void getNameHint();
     void getNetWmName();
     void getIconNameHint();
@@ -337,6 +342,8 @@ private:
 
     lazy<MwmHints> fMwmHints;
 
+    void indexClass(bool insert);
+
     Window fTransientFor;
 
     Pixmap *kwmIcons;
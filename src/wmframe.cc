@@ -1821,7 +1821,7 @@ void YFrameWindow::popupSystemMenu(YWindow *owner, int x, int y,
 void YFrameWindow::updateTitle() {
     layoutShape();
     if (fTitleBar)
-        fTitleBar->repaint();
+        fTitleBar->invalidate();
     if (fWinListItem && windowList)
         windowList->repaintItem(fWinListItem);
     if (fTaskBarApp) {
@@ -2324,7 +2324,7 @@ void YFrameWindow::updateIcon() {
     }
 
     if (fTitleBar && fTitleBar->menuButton())
-        fTitleBar->menuButton()->repaint();
+        fTitleBar->menuButton()->invalidate();
     if (fMiniIcon)
         fMiniIcon->updateIcon();
     if (fTrayApp)
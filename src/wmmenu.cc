@@ -5,6 +5,8 @@
  */
 #include "config.h"
 #include "wmprog.h"
+#include "wmmenucache.h"
+#include "yspawn.h"
 #include "yconfig.h"
 #include "ypointer.h"
 #include "wmapp.h"
@@ -85,7 +87,52 @@ static mstring guessIconNameFromExe(const char* exe)
     return "-";
 }
 
-char* MenuLoader::parseKey(char *word, char *p)
+// The command as found in PATH, or empty.
+static unsigned resolve(MenuCache& code, const char* command) {
+    csmart path(path_lookup(command));
+    return code.intern(path);
+}
+
+// A program which was found when compiling is only checked again,
+// others are looked up, as they may have been installed since.
+// When the program has gone from its path it is looked up anew.
+static char* lookup(const MenuCache& code, const MenuCache::Record& rec) {
+    const char* path = code.string(rec.path);
+    char* found = *path ? path_lookup(path) : nullptr;
+    return found ? found : path_lookup(code.string(rec.command));
+}
+
+// A guessed icon is guessed again when the program was found elsewhere.
+static ref<YIcon> recordIcon(const MenuCache& code,
+                             const MenuCache::Record& rec,
+                             const char* path = nullptr)
+{
+    if ((rec.flags & MenuCache::rfGuessIcon) && path &&
+        strcmp(path, code.string(rec.path)))
+    {
+        mstring guess(guessIconNameFromExe(path));
+        return guess.charAt(0) != '-' ? YIcon::getIcon(guess) : null;
+    }
+    const char* icons = code.string(rec.icon);
+    return *icons ? YIcon::getIcon(icons) : null;
+}
+
+// The icon name to record for an icons argument.
+static unsigned iconName(MenuCache& code, const char* icons,
+                         const char* command = nullptr)
+{
+    if (icons[0] == '!' && command) {
+        mstring iconName = guessIconNameFromExe(command);
+        if (iconName.charAt(0) != '-')
+            return code.intern(iconName);
+    }
+    else if (icons[0] != '-') {
+        return code.intern(icons);
+    }
+    return 0;
+}
+
+char* MenuLoader::parseKey(char *word, char *p, MenuCache& code)
 {
     bool runonce = !strcmp(word, "runonce");
     bool switchkey = !strcmp(word, "switchkey");
@@ -111,22 +158,21 @@ char* MenuLoader::parseKey(char *word, char *p)
         return p;
     }
 
-    DProgram *prog = DProgram::newProgram(
-        app,
-        smActionListener,
-        key,
-        null,
-        false,
-        runonce ? wmclass.cstr() : nullptr,
-        command.cstr(),
-        args);
-
-    if (prog) new KProgram(key, prog, switchkey);
+    MenuCache::Record rec = {};
+    rec.kind = runonce ? MenuCache::mkRunOnceKey :
+               switchkey ? MenuCache::mkSwitchKey : MenuCache::mkKey;
+    rec.name = code.intern(key);
+    rec.extra = runonce ? code.intern(wmclass) : 0;
+    rec.command = code.intern(command);
+    rec.path = resolve(code, command);
+    rec.args = code.arguments(args);
+    rec.argc = unsigned(args.getCount() - 1);
+    code.append(rec);
 
     return p;
 }
 
-char* MenuLoader::parseProgram(char *word, char *p, ObjectContainer *container)
+char* MenuLoader::parseProgram(char *word, char *p, MenuCache& code)
 {
     bool runonce = !strcmp(word, "runonce");
     bool restart = !strcmp(word, "restart");
@@ -157,34 +203,23 @@ char* MenuLoader::parseProgram(char *word, char *p, ObjectContainer *container)
         return p;
     }
 
-    ref<YIcon> icon;
-
-    if (icons[0] == '!')
-    {
-        mstring iconName = guessIconNameFromExe(command);
-        if (iconName.charAt(0) != '-')
-            icon = YIcon::getIcon(iconName);
-
-    }
-    else if (icons[0] != '-')
-        icon = YIcon::getIcon(icons);
-
-    DProgram * prog = DProgram::newProgram(
-        app,
-        smActionListener,
-        name,
-        icon,
-        restart,
-        runonce ? wmclass.cstr() : nullptr,
-        command.cstr(),
-        args);
-
-    if (prog) container->addObject(prog);
+    MenuCache::Record rec = {};
+    rec.kind = runonce ? MenuCache::mkRunOnce :
+               restart ? MenuCache::mkRestart : MenuCache::mkProgram;
+    rec.name = code.intern(name);
+    rec.icon = iconName(code, icons, command);
+    rec.extra = runonce ? code.intern(wmclass) : 0;
+    rec.command = code.intern(command);
+    rec.path = resolve(code, command);
+    rec.flags = (icons[0] == '!') ? MenuCache::rfGuessIcon : 0;
+    rec.args = code.arguments(args);
+    rec.argc = unsigned(args.getCount() - 1);
+    code.append(rec);
 
     return p;
 }
 
-char* MenuLoader::parseAMenu(char *p, ObjectContainer *container)
+char* MenuLoader::parseAMenu(char *p, MenuCache& code)
 {
     Argument name;
 
@@ -204,28 +239,22 @@ char* MenuLoader::parseAMenu(char *p, ObjectContainer *container)
     if (*p != '{') return nullptr;
     p++;
 
-    ref<YIcon> icon;
-    if (icons[0] != '-')
-        icon = YIcon::getIcon(icons);
-
-    ObjectMenu *sub = new ObjectMenu(wmActionListener);
+    MenuCache::Record rec = {};
+    rec.kind = MenuCache::mkMenu;
+    rec.name = code.intern(name);
+    rec.icon = iconName(code, icons);
+    code.append(rec);
 
-    if (sub) {
-        p = parseMenus(p, sub);
+    p = compileMenus(p, code, false);
 
-        if (sub->itemCount() == 0)
-            delete sub;
-        else
-            container->addContainer(name.cstr(), icon, sub);
+    MenuCache::Record end = {};
+    end.kind = MenuCache::mkEnd;
+    code.append(end);
 
-    } else {
-        msg(_("Unexepected menu keyword: '%s'"), name.cstr());
-        return p;
-    }
     return p;
 }
 
-char* MenuLoader::parseMenuFile(char *p, ObjectContainer *container)
+char* MenuLoader::parseMenuFile(char *p, MenuCache& code)
 {
     Argument name;
 
@@ -242,59 +271,19 @@ char* MenuLoader::parseMenuFile(char *p, ObjectContainer *container)
     p = YConfig::getArgument(&menufile, p);
     if (p == nullptr) return p;
 
-    ref<YIcon> icon;
-    if (icons[0] != '-')
-        icon = YIcon::getIcon(icons);
-
-    ObjectMenu *filemenu = new MenuFileMenu(
-            app, smActionListener, wmActionListener,
-            menufile.cstr(), nullptr);
-
-    if (menufile)
-        container->addContainer(name.cstr(), icon, filemenu);
-
-    return p;
-}
-
-char* MenuLoader::parseMenuProg(char *p, ObjectContainer *container)
-{
-    Argument name;
-
-    p = YConfig::getArgument(&name, p);
-    if (p == nullptr) return p;
-
-    Argument icons;
-
-    p = YConfig::getArgument(&icons, p);
-    if (p == nullptr) return p;
-
-    Argument command;
-    YStringArray args;
-
-    p = getCommandArgs(p, &command, args);
-    if (p == nullptr) {
-        msg(_("Error at menuprog '%s'"), name.cstr());
-        return p;
-    }
-
-    ref<YIcon> icon;
-    if (icons[0] != '-')
-        icon = YIcon::getIcon(icons);
-    MSG(("menuprog %s %s", name.cstr(), command.cstr()));
-
-    csmart path(path_lookup(command.cstr()));
-    if (path) {
-        ObjectMenu *progmenu = new MenuProgMenu(
-                app, smActionListener, wmActionListener,
-                name.cstr(), command.cstr(), args);
-        if (progmenu)
-            container->addContainer(name.cstr(), icon, progmenu);
+    if (menufile) {
+        MenuCache::Record rec = {};
+        rec.kind = MenuCache::mkMenuFile;
+        rec.name = code.intern(name);
+        rec.icon = iconName(code, icons);
+        rec.extra = code.intern(menufile);
+        code.append(rec);
     }
 
     return p;
 }
 
-char* MenuLoader::parseMenuProgReload(char *p, ObjectContainer *container)
+char* MenuLoader::parseMenuProg(char *p, MenuCache& code, bool reload)
 {
     Argument name;
 
@@ -306,39 +295,45 @@ char* MenuLoader::parseMenuProgReload(char *p, ObjectContainer *container)
     p = YConfig::getArgument(&icons, p);
     if (p == nullptr) return p;
 
-    Argument timeoutStr;
+    long timeout = 0;
+    if (reload) {
+        Argument timeoutStr;
 
-    p = YConfig::getArgument(&timeoutStr, p);
-    if (p == nullptr) return p;
-    long timeout = atol(timeoutStr);
+        p = YConfig::getArgument(&timeoutStr, p);
+        if (p == nullptr) return p;
+        timeout = atol(timeoutStr);
+    }
 
     Argument command;
     YStringArray args;
 
     p = getCommandArgs(p, &command, args);
     if (p == nullptr) {
-        msg(_("Error at menuprogreload: '%s'"), name.cstr());
+        if (reload)
+            msg(_("Error at menuprogreload: '%s'"), name.cstr());
+        else
+            msg(_("Error at menuprog '%s'"), name.cstr());
         return p;
     }
 
-    ref<YIcon> icon;
-    if (icons[0] != '-')
-        icon = YIcon::getIcon(icons);
-    MSG(("menuprogreload %s %s", name.cstr(), command.cstr()));
+    MSG(("%s %s %s", reload ? "menuprogreload" : "menuprog",
+         name.cstr(), command.cstr()));
 
-    csmart path(path_lookup(command.cstr()));
-    if (path) {
-        ObjectMenu *progmenu = new MenuProgMenu(
-                app, smActionListener, wmActionListener,
-                name.cstr(), command.cstr(), args, timeout);
-        if (progmenu)
-            container->addContainer(name.cstr(), icon, progmenu);
-    }
+    MenuCache::Record rec = {};
+    rec.kind = reload ? MenuCache::mkMenuProgReload : MenuCache::mkMenuProg;
+    rec.name = code.intern(name);
+    rec.icon = iconName(code, icons);
+    rec.command = code.intern(command);
+    rec.path = resolve(code, command);
+    rec.args = code.arguments(args);
+    rec.argc = unsigned(args.getCount() - 1);
+    rec.timeout = int32_t(timeout);
+    code.append(rec);
 
     return p;
 }
 
-char* MenuLoader::parseIncludeStatement(char *p, ObjectContainer *container)
+char* MenuLoader::parseIncludeStatement(char *p, MenuCache& code, bool keys)
 {
     Argument filename;
 
@@ -349,13 +344,14 @@ char* MenuLoader::parseIncludeStatement(char *p, ObjectContainer *container)
     }
 
     upath path(app->findConfigFile(filename.cstr()));
+    code.depend(filename.cstr(), path);
     if (path != null)
-        loadMenus(path, container);
+        compileFile(path, code, keys);
 
     return p;
 }
 
-char* MenuLoader::parseIncludeProgStatement(char *p, ObjectContainer *container)
+char* MenuLoader::parseIncludeProgStatement(char *p, MenuCache& code)
 {
     Argument command;
     YStringArray args;
@@ -366,40 +362,47 @@ char* MenuLoader::parseIncludeProgStatement(char *p, ObjectContainer *container)
         return p;
     }
 
-    progMenus(command.cstr(), args.getCArray(), container);
+    MenuCache::Record rec = {};
+    rec.kind = MenuCache::mkIncludeProg;
+    rec.command = code.intern(command);
+    rec.args = code.arguments(args);
+    rec.argc = unsigned(args.getCount() - 1);
+    code.append(rec);
 
     return p;
 }
 
-char* MenuLoader::parseWord(char *word, char *p, ObjectContainer *container)
+char* MenuLoader::parseWord(char *word, char *p, MenuCache& code, bool keys)
 {
-    if (container) {
+    if (keys == false) {
         if (!strcmp(word, "separator")) {
-            container->addSeparator();
+            MenuCache::Record rec = {};
+            rec.kind = MenuCache::mkSeparator;
+            code.append(rec);
         }
         else if (!(strcmp(word, "prog") &&
                    strcmp(word, "restart") &&
                    strcmp(word, "runonce")))
         {
-            p = parseProgram(word, p, container);
+            p = parseProgram(word, p, code);
         }
         else if (!strcmp(word, "menu")) {
-            p = parseAMenu(p, container);
+            p = parseAMenu(p, code);
         }
         else if (!strcmp(word, "menufile")) {
-            p = parseMenuFile(p, container);
+            p = parseMenuFile(p, code);
         }
         else if (!strcmp(word, "menuprog")) {
-            p = parseMenuProg(p, container);
+            p = parseMenuProg(p, code, false);
         }
         else if (!strcmp(word, "menuprogreload")) {
-            p = parseMenuProgReload(p, container);
+            p = parseMenuProg(p, code, true);
         }
         else if (!strcmp(word, "include")) {
-            p = parseIncludeStatement(p, container);
+            p = parseIncludeStatement(p, code, keys);
         }
         else if (!strcmp(word, "includeprog")) {
-            p = parseIncludeProgStatement(p, container);
+            p = parseIncludeProgStatement(p, code);
         }
         else if (*p == '}') {
             return p;
@@ -413,7 +416,7 @@ char* MenuLoader::parseWord(char *word, char *p, ObjectContainer *container)
           || !strcmp(word, "runonce")
           || !strcmp(word, "switchkey"))
     {
-        p = parseKey(word, p);
+        p = parseKey(word, p, code);
     }
     else {
         msg(_("Unknown keyword for a non-container: '%s'.\n"
@@ -423,7 +426,7 @@ char* MenuLoader::parseWord(char *word, char *p, ObjectContainer *container)
     return p;
 }
 
-char* MenuLoader::parseMenus(char *data, ObjectContainer *container)
+char* MenuLoader::compileMenus(char *data, MenuCache& code, bool keys)
 {
     for (char* p = data; p && *p; ) {
         if (ASCII::isWhiteSpace(*p)) {
@@ -438,61 +441,181 @@ char* MenuLoader::parseMenus(char *data, ObjectContainer *container)
         else {
             char word[32];
             p = getWord(word, sizeof(word), p);
-            p = parseWord(word, p, container);
+            p = parseWord(word, p, code, keys);
         }
     }
     return nullptr;
 }
 
+void MenuLoader::compileFile(upath menufile, MenuCache& code, bool keys)
+{
+    MSG(("menufile: %s", menufile.string()));
+    YTraceConfig trace(menufile.string());
+    auto buf = menufile.loadText();
+    if (buf) compileMenus(buf, code, keys);
+}
+
+// Create the objects for the records from index up to the end of a menu.
+unsigned MenuLoader::build(const MenuCache& code, unsigned index,
+                           ObjectContainer *container, bool prefetch)
+{
+    const unsigned count = code.count();
+    while (index < count) {
+        const MenuCache::Record& rec = code.record(index++);
+        const char* name = code.string(rec.name);
+
+        switch (rec.kind) {
+        case MenuCache::mkSeparator:
+            container->addSeparator();
+            break;
+
+        case MenuCache::mkProgram:
+        case MenuCache::mkRestart:
+        case MenuCache::mkRunOnce:
+        case MenuCache::mkKey:
+        case MenuCache::mkRunOnceKey:
+        case MenuCache::mkSwitchKey: {
+            csmart path(lookup(code, rec));
+            YStringArray args;
+            code.arguments(rec, args);
+            const bool key = (rec.kind >= MenuCache::mkKey);
+            const bool once = (rec.kind == MenuCache::mkRunOnce ||
+                               rec.kind == MenuCache::mkRunOnceKey);
+            DProgram *prog = DProgram::newProgram(
+                app,
+                smActionListener,
+                name,
+                key ? null : recordIcon(code, rec, path),
+                rec.kind == MenuCache::mkRestart,
+                once ? code.string(rec.extra) : nullptr,
+                path ? path : code.string(rec.command),
+                args);
+            if (prog == nullptr)
+                break;
+            if (key)
+                new KProgram(name, prog, rec.kind == MenuCache::mkSwitchKey);
+            else
+                container->addObject(prog);
+            break;
+        }
+
+        case MenuCache::mkMenu: {
+            ObjectMenu *sub = new ObjectMenu(wmActionListener);
+            index = build(code, index, sub);
+            if (sub->itemCount() == 0)
+                delete sub;
+            else
+                container->addContainer(name, recordIcon(code, rec), sub);
+            break;
+        }
+
+        case MenuCache::mkMenuFile: {
+            ObjectMenu *filemenu = new MenuFileMenu(
+                    app, smActionListener, wmActionListener,
+                    code.string(rec.extra), nullptr);
+            container->addContainer(name, recordIcon(code, rec), filemenu);
+            break;
+        }
+
+        case MenuCache::mkMenuProg:
+        case MenuCache::mkMenuProgReload: {
+            csmart path(lookup(code, rec));
+            if (path) {
+                YStringArray args;
+                code.arguments(rec, args);
+                const char* command = code.string(rec.command);
+                ObjectMenu *progmenu =
+                    rec.kind == MenuCache::mkMenuProgReload ?
+                    new MenuProgMenu(app, smActionListener, wmActionListener,
+                                     name, command, args, rec.timeout,
+                                     nullptr, prefetch) :
+                    new MenuProgMenu(app, smActionListener, wmActionListener,
+                                     name, command, args, 60L,
+                                     nullptr, prefetch);
+                container->addContainer(name, recordIcon(code, rec),
+                                        progmenu);
+            }
+            break;
+        }
+
+        case MenuCache::mkIncludeProg: {
+            YStringArray args;
+            code.arguments(rec, args);
+            progMenus(code.string(rec.command), args.getCArray(), container);
+            break;
+        }
+
+        case MenuCache::mkEnd:
+            return index;
+        }
+    }
+    return index;
+}
+
+void MenuLoader::parseMenus(char *data, ObjectContainer *container)
+{
+    MenuCache code;
+    compileMenus(data, code, container == nullptr);
+    code.finish();
+    build(code, 0, container);
+}
+
 void MenuLoader::loadMenus(upath menufile, ObjectContainer *container)
 {
     if (menufile.isEmpty())
         return;
 
-    MSG(("menufile: %s", menufile.string()));
-    YTraceConfig trace(menufile.string());
-    auto buf = menufile.loadText();
-    if (buf) parseMenus(buf, container);
+    const bool keys = (container == nullptr);
+    MenuCache code;
+    if (code.load(menufile, keys, app) == false) {
+        code.depend(nullptr, menufile);
+        compileFile(menufile, code, keys);
+        code.finish();
+        if (code.save(menufile, keys) == false) {
+            MSG(("could not save compiled %s", menufile.string()));
+        }
+    }
+    build(code, 0, container, true);
 }
 
-void MenuLoader::progMenus(
-    const char *command,
-    char *const argv[],
-    ObjectContainer *container)
+int MenuLoader::progStart(const char *command, char *const argv[], int *out)
 {
     int fds[2];
     if (pipe(fds) == -1) {
         fail("pipe");
-        return;
+        return -1;
     }
 
-    int pid = fork();
+    YSpawn spawn;
+    spawn.nullInput();
+    spawn.output(fds[1]);
+    spawn.closeFile(fds[0]);
+
+    csmart path(path_lookup(command));
+    int pid = path ? spawn.spawn(path, argv, false) : -1;
     if (pid == -1) {
-        fail("Forking '%s' failed", command);
-    }
-    else if (pid == 0) {
+        fail("Exec '%s' failed", path ? (const char *) path : command);
         close(fds[0]);
-        int devnull = open("/dev/null", O_RDONLY);
-        if (devnull > 0) {
-            dup2(devnull, 0);
-            close(devnull);
-        }
-        if (fds[1] > 1 && (dup2(fds[1], 1) != 1 || close(fds[1]))) {
-            fail("dup2!=1");
-        }
-        else {
-            char* path = path_lookup(command);
-            if (path) {
-                execv(path, argv);
-            }
-            fail("Exec '%s' failed", path ? path : command);
-        }
-        _exit(99);
+        close(fds[1]);
     }
     else {
         close(fds[1]);
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        *out = fds[0];
+    }
+    return pid;
+}
+
+void MenuLoader::progMenus(
+    const char *command,
+    char *const argv[],
+    ObjectContainer *container)
+{
+    int fd = -1;
+    int pid = progStart(command, argv, &fd);
+    if (pid > 0) {
         bool expired = false;
-        filereader rdr(fds[0]);
+        filereader rdr(fd);
         auto buf = rdr.read_pipe(TIMEOUT_MS, &expired);
         if (expired) {
             warn("'%s' timed out!", command);
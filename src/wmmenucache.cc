@@ -0,0 +1,231 @@
+/*
+ * IceWM
+ *
+ * Compiled menu files.
+ *
+ * A file consists of a header, one source record per file which was
+ * read, the menu records, the argument lists as string offsets, and
+ * finally all strings, each terminated by a zero byte.
+ */
+#include "config.h"
+#include "wmmenucache.h"
+#include "yarray.h"
+#include "yapp.h"
+#include "debug.h"
+#include "base.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+static const char cacheMagic[8] = { 'I', 'c', 'e', 'M', 'e', 'n', 'u', '2' };
+
+struct MenuCache::Header {
+    char magic[8];
+    uint64_t environment;   // hash of the variables for path lookups
+    uint32_t sources;
+    uint32_t records;
+    uint32_t args;
+    uint32_t strings;       // bytes
+};
+
+MenuCache::MenuCache() :
+    fData(nullptr),
+    fSize(0)
+{
+}
+
+MenuCache::~MenuCache() {
+    unmap();
+}
+
+void MenuCache::unmap() {
+    fMap.unmap();
+    fData = nullptr;
+    fSize = 0;
+    std::vector<char>().swap(fBuffer);
+}
+
+const MenuCache::Header* MenuCache::header() const {
+    return reinterpret_cast<const Header *>(fData);
+}
+
+const MenuCache::Source* MenuCache::sources() const {
+    return reinterpret_cast<const Source *>(fData + sizeof(Header));
+}
+
+const MenuCache::Record* MenuCache::records() const {
+    return reinterpret_cast<const Record *>(sources() + header()->sources);
+}
+
+const uint32_t* MenuCache::argv() const {
+    return reinterpret_cast<const uint32_t *>(records() + header()->records);
+}
+
+const char* MenuCache::string(unsigned offset) const {
+    const char* strings = reinterpret_cast<const char *>(
+                          argv() + header()->args);
+    return offset < header()->strings ? strings + offset : "";
+}
+
+unsigned MenuCache::count() const {
+    return fData ? header()->records : 0;
+}
+
+const MenuCache::Record& MenuCache::record(unsigned index) const {
+    return records()[index];
+}
+
+void MenuCache::arguments(const Record& record, YStringArray& args) const {
+    const uint32_t* list = argv();
+    for (unsigned i = 0; i < record.argc; ++i)
+        if (record.args + i < header()->args)
+            args.append(string(list[record.args + i]));
+    args.append(nullptr);
+}
+
+unsigned MenuCache::intern(const char* str) {
+    if (str == nullptr || *str == '\0')
+        return 0;
+    if (fStrings.empty())
+        fStrings.push_back('\0');
+    unsigned offset = unsigned(fStrings.size());
+    fStrings.append(str, strlen(str) + 1);
+    return offset;
+}
+
+unsigned MenuCache::arguments(const YStringArray& args) {
+    unsigned first = unsigned(fArgs.size());
+    for (int i = 0; i < args.getCount() && args[i]; ++i)
+        fArgs.push_back(intern(args[i]));
+    return first;
+}
+
+void MenuCache::depend(const char* name, upath path) {
+    Source source = { intern(name), intern(path.string()), -1, -1, -1 };
+    struct stat st;
+    if (path.stat(&st) == 0) {
+        source.modified = int64_t(st.st_mtime);
+        source.length = int64_t(st.st_size);
+        source.inode = int64_t(st.st_ino);
+    }
+    fSources.push_back(source);
+}
+
+void MenuCache::finish() {
+    unmap();
+    if (fStrings.empty())
+        fStrings.push_back('\0');
+
+    const size_t size = sizeof(Header)
+                      + fSources.size() * sizeof(Source)
+                      + fRecords.size() * sizeof(Record)
+                      + fArgs.size() * sizeof(uint32_t)
+                      + fStrings.size();
+    fBuffer.assign(size, '\0');
+
+    char* data = fBuffer.data();
+    Header* head = reinterpret_cast<Header *>(data);
+    memcpy(head->magic, cacheMagic, sizeof cacheMagic);
+    head->environment = environment();
+    head->sources = unsigned(fSources.size());
+    head->records = unsigned(fRecords.size());
+    head->args = unsigned(fArgs.size());
+    head->strings = unsigned(fStrings.size());
+
+    char* next = data + sizeof(Header);
+    memcpy(next, fSources.data(), fSources.size() * sizeof(Source));
+    next += fSources.size() * sizeof(Source);
+    memcpy(next, fRecords.data(), fRecords.size() * sizeof(Record));
+    next += fRecords.size() * sizeof(Record);
+    memcpy(next, fArgs.data(), fArgs.size() * sizeof(uint32_t));
+    next += fArgs.size() * sizeof(uint32_t);
+    memcpy(next, fStrings.data(), fStrings.size());
+
+    std::vector<Source>().swap(fSources);
+    std::vector<Record>().swap(fRecords);
+    std::vector<uint32_t>().swap(fArgs);
+    std::string().swap(fStrings);
+
+    fData = data;
+    fSize = size;
+}
+
+uint64_t MenuCache::environment() {
+    uint64_t hash = fnvOffset;
+    hash = fnvHash(hash, getenv("PATH"));
+    hash = fnvHash(hash, getenv("HOME"));
+    return hash;
+}
+
+upath MenuCache::location(upath file, bool keys) {
+    uint64_t hash = fnvOffset;
+    hash = fnvHash(hash, file.string());
+    hash = fnvHash(hash, keys ? "keys" : "menu");
+    char name[40];
+    snprintf(name, sizeof name, "/menus/%016llx", (unsigned long long) hash);
+    return upath(YApplication::getCacheDir() + name);
+}
+
+bool MenuCache::verify(IApp* app) const {
+    const Header* head = header();
+    if (head->environment != environment())
+        return false;
+
+    const size_t size = sizeof(Header)
+                      + head->sources * sizeof(Source)
+                      + head->records * sizeof(Record)
+                      + head->args * sizeof(uint32_t)
+                      + head->strings;
+    if (size != fSize || head->strings == 0 || fData[fSize - 1])
+        return false;
+
+    for (unsigned i = 0; i < head->sources; ++i) {
+        const Source& source = sources()[i];
+        const char* path = string(source.path);
+        if (source.name) {
+            upath found(app->findConfigFile(string(source.name)));
+            if (strcmp(found != null ? found.string() : "", path))
+                return false;
+        }
+        if (*path == '\0' && source.name)
+            continue;
+        struct stat st;
+        if (*path == '\0' ||
+            stat(path, &st) ||
+            int64_t(st.st_mtime) != source.modified ||
+            int64_t(st.st_size) != source.length ||
+            int64_t(st.st_ino) != source.inode)
+            return false;
+    }
+    return true;
+}
+
+bool MenuCache::load(upath file, bool keys, IApp* app) {
+    unmap();
+
+    upath path(location(file, keys));
+    if (fMap.map(path, cacheMagic, sizeof(Header))) {
+        fData = fMap.data();
+        fSize = fMap.size();
+    }
+    if (fData && verify(app)) {
+        MSG(("using menu cache %s for %s", path.string(), file.string()));
+        return true;
+    }
+    unmap();
+    return false;
+}
+
+bool MenuCache::save(upath file, bool keys) const {
+    if (fData == nullptr)
+        return false;
+
+    upath dest(location(file, keys));
+    upath dir(dest.parent());
+    if (dir.dirExists() == false)
+        dir.mkdir();
+
+    return replaceFile(dest, fData, fSize);
+}
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,114 @@
+#ifndef WMMENUCACHE_H
+#define WMMENUCACHE_H
+
+#include "upath.h"
+#include "ycachefile.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class IApp;
+class YStringArray;
+
+/*
+ * A menu file in compiled form: a flat array of records with all
+ * strings in one pool. The records of a submenu follow its menu
+ * record up to an end record. Included files are inlined. Commands
+ * are resolved in PATH and the icon names of programs are guessed
+ * when compiling. The compiled form of a file is kept in the user
+ * cache directory and mapped, as long as the files it was compiled
+ * from are unchanged.
+ */
+class MenuCache {
+public:
+    enum Kind {
+        mkSeparator,
+        mkProgram,
+        mkRestart,
+        mkRunOnce,
+        mkMenu,
+        mkMenuFile,
+        mkMenuProg,
+        mkMenuProgReload,
+        mkIncludeProg,
+        mkKey,
+        mkRunOnceKey,
+        mkSwitchKey,
+        mkEnd,
+    };
+
+    enum Flags {
+        rfGuessIcon = 1,    // the icon was guessed from the path
+    };
+
+    struct Record {
+        uint32_t kind;
+        uint32_t name;      // or key
+        uint32_t icon;      // icon name, or empty for none
+        uint32_t extra;     // class of runonce, or name of a menufile
+        uint32_t command;
+        uint32_t path;      // command found in PATH, or empty
+        uint32_t args;      // index of the first argument
+        uint32_t argc;
+        int32_t timeout;
+        uint32_t flags;
+    };
+
+    MenuCache();
+    ~MenuCache();
+
+    // Map the compiled form of file, if it is up to date.
+    bool load(upath file, bool keys, IApp* app);
+    // Store the compiled form of file.
+    bool save(upath file, bool keys) const;
+
+    // Compilation appends to a new form, which is final after finish.
+    unsigned intern(const char* str);
+    unsigned arguments(const YStringArray& args);
+    void append(const Record& record) { fRecords.push_back(record); }
+    // A file which is read, as found for name by findConfigFile.
+    void depend(const char* name, upath path);
+    void finish();
+
+    unsigned count() const;
+    const Record& record(unsigned index) const;
+    const char* string(unsigned offset) const;
+    // The argument list of a record, terminated by a null.
+    void arguments(const Record& record, YStringArray& args) const;
+
+private:
+    struct Header;
+    struct Source {
+        uint32_t name;      // as given to findConfigFile, or empty
+        uint32_t path;
+        int64_t modified;
+        int64_t length;
+        int64_t inode;
+    };
+
+    std::vector<Source> fSources;
+    std::vector<Record> fRecords;
+    std::vector<uint32_t> fArgs;
+    std::string fStrings;
+
+    const char* fData;
+    size_t fSize;
+    YCacheMap fMap;
+    std::vector<char> fBuffer;
+
+    const Header* header() const;
+    const Source* sources() const;
+    const Record* records() const;
+    const uint32_t* argv() const;
+    bool verify(IApp* app) const;
+    void unmap();
+    static upath location(upath file, bool keys);
+    static uint64_t environment();
+
+    MenuCache(const MenuCache&);
+    MenuCache& operator=(const MenuCache&);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
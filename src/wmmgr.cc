@@ -855,64 +855,6 @@ void YWindowManager::handleFocus(const XFocusChangeEvent &focus) {
     }
 }
 
-Window YWindowManager::findWindow(const char *resource) {
-    if (isEmpty(resource))
-        return None;
-
-    for (YFrameIter iter = focusedReverseIterator(); ++iter; ) {
-        YFrameClient* cli(iter->client());
-        if (cli && cli->adopted() && !cli->destroyed()) {
-            if (cli->classHint()->match(resource)) {
-                return cli->handle();
-            }
-        }
-    }
-
-    Window match = None, root = desktop->handle(), parent;
-    xsmart<Window> clients;
-    unsigned count = 0;
-    XQueryTree(xapp->display(), root, &root, &parent, &clients, &count);
-
-    for (unsigned i = 0; match == None && i < count; ++i) {
-        YWindow* ywin = windowContext.find(clients[i]);
-        if (nullptr == ywin) {
-            match = matchWindow(clients[i], resource);
-        }
-    }
-
-    return match;
-}
-
-Window YWindowManager::findWindow(Window win, char const* resource,
-                                  int maxdepth) {
-    if (isEmpty(resource))
-        return None;
-
-    Window match = None, parent, root;
-    xsmart<Window> clients;
-    unsigned count = 0;
-
-    XQueryTree(xapp->display(), win, &root, &parent, &clients, &count);
-
-    for (unsigned i = 0; match == None && i < count; ++i) {
-        if (matchWindow(clients[i], resource))
-            match = clients[i];
-    }
-    if (maxdepth) {
-        for (unsigned i = 0; match == None && i < count; ++i) {
-            match = findWindow(clients[i], resource, maxdepth - 1);
-        }
-    }
-
-    return match;
-}
-
-bool YWindowManager::matchWindow(Window win, char const* resource) {
-    ClassHint hint;
-    return XGetClassHint(xapp->display(), handle(), &hint)
-        && hint.match(resource);
-}
-
 YFrameWindow *YWindowManager::findFrame(Window win) {
     return frameContext.find(win);
 }
@@ -81,10 +81,6 @@ public:
     void grabServer();
     void ungrabServer();
 
-    Window findWindow(char const* resource);
-    Window findWindow(Window root, char const* resource, int maxdepth);
-    bool matchWindow(Window win, char const* resource);
-
     YFrameWindow *findFrame(Window win);
     YFrameClient *findClient(Window win);
     void manageClient(Window win, bool mapClient = false);
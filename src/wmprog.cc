@@ -14,9 +14,24 @@
 #include "appnames.h"
 #include "wmpref.h"
 #include "wmswitch.h"
+#include "yfileio.h"
 #include "intl.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <time.h>
+#include <unistd.h>
+
+// how long a menu program may run in the background
+#define PROGRAM_TIMEOUT_MS  10000
+// when menu programs are started after the menu was created
+#define PREFETCH_DELAY_MS   2000
+// how many menu programs are prefetched at the same time
+#define PREFETCH_LIMIT      2
+// how long a popup waits for a program which is still running
+#define POPUP_TIMEOUT_MS    700
 
 DFile::DFile(IApp *app, const mstring &name, ref<YIcon> icon, upath path):
     DObject(app, name, icon), fPath(path)
@@ -206,45 +221,32 @@ MenuFileMenu::MenuFileMenu(
     ObjectMenu(wmActionListener, parent),
     MenuLoader(app, smActionListener, wmActionListener),
     fName(name),
-    fModTime(0),
+    fWatch(this),
+    fStale(true),
     app(app)
 {
+    if (autoReloadMenus)
+        fWatch.addConfig(upath(fName));
 }
 
 MenuFileMenu::~MenuFileMenu() {
 }
 
 void MenuFileMenu::updatePopup() {
-    if (!autoReloadMenus && fPath != null)
-        return;
-
-    upath np = app->findConfigFile(upath(fName));
-    bool rel = false;
-
+    if (fStale)
+        reload();
+}
 
-    if (fPath == null) {
-        fPath = np;
-        rel = true;
-    } else {
-        if (np == null || np.equals(fPath)) {
-            fPath = np;
-            rel = true;
-        } else
-            np = null;
-    }
+void MenuFileMenu::handleFileChange(YFileWatch* watch) {
+    fStale = true;
+    if (fPath != null && visible() == false)
+        reload();
+}
 
-    if (fPath == null) {
-        refresh();
-    } else {
-        struct stat sb;
-        if (stat(fPath.string(), &sb) != 0) {
-            fPath = null;
-            refresh();
-        } else if (sb.st_mtime > fModTime || rel) {
-            fModTime = sb.st_mtime;
-            refresh();
-        }
-    }
+void MenuFileMenu::reload() {
+    fStale = false;
+    fPath = app->findConfigFile(upath(fName));
+    refresh();
 }
 
 void MenuFileMenu::refresh() {
@@ -261,7 +263,8 @@ MenuProgMenu::MenuProgMenu(
     upath command,
     YStringArray &args,
     long timeout,
-    YWindow *parent)
+    YWindow *parent,
+    bool prefetch)
     :
     ObjectMenu(wmActionListener, parent),
     MenuLoader(app, smActionListener, wmActionListener),
@@ -269,28 +272,177 @@ MenuProgMenu::MenuProgMenu(
     fCommand(command),
     fArgs(args),
     fModTime(0),
-    fTimeout(timeout)
+    fTimeout(timeout),
+    fPoll(this),
+    fPid(0),
+    fReady(false),
+    fPrefetching(false)
 {
+    if (prefetch && prefetchMenuProgs && fCommand != null)
+        fTimer->setTimer(PREFETCH_DELAY_MS, this, true);
 }
 
+int MenuProgMenu::prefetches;
+
 MenuProgMenu::~MenuProgMenu() {
+    stopProgram();
 }
 
 void MenuProgMenu::updatePopup() {
+    if (fPid > 0 && fModTime == 0)
+        waitProgram();
+    if (fReady)
+        applyOutput();
+
     time_t now = time(nullptr);
-    if (fModTime == 0 || (0 < fTimeout && now >= fModTime + fTimeout)) {
+    if (fModTime == 0) {
         refresh();
         fModTime = now;
     }
+    else if (0 < fTimeout && now >= fModTime + fTimeout && fPid <= 0) {
+        startProgram();
+    }
 }
 
 void MenuProgMenu::refresh()
 {
+    stopProgram();
+    fReady = false;
     removeAll();
     if (fCommand != null)
         progMenus(fCommand.string(), fArgs.getCArray(), this);
 }
 
+void MenuProgMenu::startProgram() {
+    int fd = -1;
+    fOutput.clear();
+    fReady = false;
+    fPid = progStart(fCommand.string(), fArgs.getCArray(), &fd);
+    if (fPid > 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fPoll.registerPoll(fd);
+        fTimer->setTimer(PROGRAM_TIMEOUT_MS, this, true);
+    } else {
+        fPid = 0;
+        fModTime = time(nullptr);
+    }
+}
+
+void MenuProgPoll::notifyRead() {
+    owner()->readOutput();
+}
+
+void MenuProgMenu::readOutput() {
+    char buf[BUFSIZ];
+    for (;;) {
+        ssize_t len = read(fPoll.fd(), buf, sizeof buf);
+        if (len > 0) {
+            fOutput.append(buf, size_t(len));
+        }
+        else if (len == 0) {
+            finishProgram(true);
+            return;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        }
+        else if (errno != EINTR) {
+            finishProgram(false);
+            return;
+        }
+    }
+}
+
+// The first popup after a prefetch waits a little for the rest.
+void MenuProgMenu::waitProgram() {
+    bool expired = false;
+    filereader rdr(fPoll.fd(), false);
+    fcsmart buf(rdr.read_pipe(POPUP_TIMEOUT_MS, &expired));
+    if (buf)
+        fOutput.append(buf);
+    if (expired)
+        warn("'%s' timed out!", fCommand.string());
+    finishProgram(expired == false);
+}
+
+void MenuProgMenu::finishProgram(bool success) {
+    fTimer->stopTimer();
+    fPoll.closePoll();
+    endPrefetch();
+    if (success) {
+        int status = 0;
+        if (waitpid(fPid, &status, WNOHANG) == fPid && status) {
+            warn("'%s' exited with code %d.", fCommand.string(), status);
+            success = false;
+        }
+        else if (fOutput.empty()) {
+            warn(_("'%s' produces no output"), fCommand.string());
+            success = false;
+        }
+    } else {
+        kill(fPid, SIGKILL);
+    }
+    fPid = 0;
+    fModTime = time(nullptr);
+
+    // the items of a visible menu are replaced at the next popup
+    if (success) {
+        fReady = true;
+        if (visible() == false)
+            applyOutput();
+    } else {
+        fOutput.clear();
+    }
+}
+
+void MenuProgMenu::applyOutput() {
+    fReady = false;
+    removeAll();
+    std::string output;
+    output.swap(fOutput);
+    parseMenus(&output[0], this);
+}
+
+void MenuProgMenu::stopProgram() {
+    if (fTimer)
+        fTimer->stopTimer();
+    if (fPid > 0) {
+        kill(fPid, SIGKILL);
+        fPid = 0;
+    }
+    fPoll.closePoll();
+    fOutput.clear();
+    endPrefetch();
+}
+
+void MenuProgMenu::endPrefetch() {
+    if (fPrefetching) {
+        fPrefetching = false;
+        --prefetches;
+    }
+}
+
+bool MenuProgMenu::handleTimer(YTimer *timer) {
+    if (timer != fTimer)
+        return ObjectMenu::handleTimer(timer);
+    if (fPid <= 0) {
+        if (fModTime == 0) {
+            // wait while others are prefetched
+            if (prefetches >= PREFETCH_LIMIT)
+                return true;
+            startProgram();
+            if (fPid > 0) {
+                fPrefetching = true;
+                ++prefetches;
+            }
+        }
+    } else {
+        warn("'%s' timed out!", fCommand.string());
+        finishProgram(false);
+    }
+    return false;
+}
+
 StartMenu::StartMenu(
     IApp *app,
     YSMListener *smActionListener,
@@ -2,12 +2,17 @@
 #define __WMPROG_H
 
 #include "objmenu.h"
+#include "ypoll.h"
+#include "ytimer.h"
+#include "yfilewatch.h"
+#include <string>
 
 class ObjectContainer;
 class YSMListener;
 class YActionListener;
 class SwitchWindow;
 class MenuProgSwitchItems;
+class MenuCache;
 
 class MenuLoader {
 public:
@@ -23,17 +28,27 @@ public:
     void progMenus(const char *command, char *const argv[],
                    ObjectContainer *container);
 
+protected:
+    // Start a menu program with its output on a pipe in out.
+    int progStart(const char *command, char *const argv[], int *out);
+    void parseMenus(char *data, ObjectContainer *container);
+
 private:
-    char* parseIncludeStatement(char *p, ObjectContainer *container);
-    char* parseIncludeProgStatement(char *p, ObjectContainer *container);
-    char* parseMenus(char *data, ObjectContainer *container);
-    char* parseAMenu(char *data, ObjectContainer *container);
-    char* parseMenuFile(char *data, ObjectContainer *container);
-    char* parseMenuProg(char *data, ObjectContainer *container);
-    char* parseMenuProgReload(char *data, ObjectContainer *container);
-    char* parseKey(char *word, char *p);
-    char* parseProgram(char *word, char *p, ObjectContainer *container);
-    char* parseWord(char *word, char *p, ObjectContainer *container);
+    // Translate menu text to records.
+    char* parseIncludeStatement(char *p, MenuCache& code, bool keys);
+    char* parseIncludeProgStatement(char *p, MenuCache& code);
+    char* parseAMenu(char *data, MenuCache& code);
+    char* parseMenuFile(char *data, MenuCache& code);
+    char* parseMenuProg(char *data, MenuCache& code, bool reload);
+    char* parseKey(char *word, char *p, MenuCache& code);
+    char* parseProgram(char *word, char *p, MenuCache& code);
+    char* parseWord(char *word, char *p, MenuCache& code, bool keys);
+    char* compileMenus(char *data, MenuCache& code, bool keys);
+    void compileFile(upath menufile, MenuCache& code, bool keys);
+    // Create menu objects or keys from records. Only the menu
+    // programs which are prefetched are started in the background.
+    unsigned build(const MenuCache& code, unsigned index,
+                   ObjectContainer *container, bool prefetch = false);
 
     IApp *app;
     YSMListener *smActionListener;
@@ -88,7 +103,15 @@ private:
     upath fPath;
 };
 
-class MenuFileMenu: public ObjectMenu, private MenuLoader {
+/*
+ * A menu file is loaded at the first popup. With AutoReloadMenus it is
+ * watched for changes, which reload it while the menu is hidden.
+ */
+class MenuFileMenu:
+    public ObjectMenu,
+    private MenuLoader,
+    private YFileWatchListener
+{
 public:
     MenuFileMenu(
         IApp *app,
@@ -100,13 +123,31 @@ public:
     virtual void updatePopup();
     virtual void refresh();
 private:
+    virtual void handleFileChange(YFileWatch* watch);
+    void reload();
+
     mstring fName;
     upath fPath;
-    time_t fModTime;
+    YFileWatch fWatch;
+    bool fStale;
 protected:
     IApp *app;
 };
 
+class MenuProgPoll: public YPoll<class MenuProgMenu> {
+public:
+    explicit MenuProgPoll(MenuProgMenu* owner) : YPoll(owner) { }
+    virtual void notifyRead();
+    virtual bool forRead() { return true; }
+};
+
+/*
+ * The items of a menu program are refreshed in the background.
+ * The menu shows the previous items until the new output is complete.
+ * Only the first popup waits for the program, unless it was prefetched.
+ * Only the menu programs at the top of a menu file are prefetched,
+ * and only a few of them run at the same time.
+ */
 class MenuProgMenu: public ObjectMenu, private MenuLoader {
 public:
     MenuProgMenu(
@@ -117,18 +158,38 @@ public:
         upath command,
         YStringArray &args,
         long timeout = 60L,
-        YWindow *parent = nullptr);
+        YWindow *parent = nullptr,
+        bool prefetch = false);
 
     virtual ~MenuProgMenu();
     virtual void updatePopup();
     virtual void refresh();
 
+    void readOutput();
+    virtual bool handleTimer(YTimer *timer);
+
 private:
+    void startProgram();
+    void waitProgram();
+    void finishProgram(bool success);
+    void stopProgram();
+    void applyOutput();
+    void endPrefetch();
+
     mstring fName;
     upath fCommand;
     YStringArray fArgs;
     time_t fModTime;
     long fTimeout;
+
+    MenuProgPoll fPoll;
+    lazy<YTimer> fTimer;
+    std::string fOutput;
+    int fPid;
+    bool fReady;            // complete output which is not yet applied
+    bool fPrefetching;      // counted in the running prefetches
+
+    static int prefetches;
 };
 
 class FocusMenu: public YMenu {
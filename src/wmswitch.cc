@@ -18,34 +18,109 @@ class WindowItemsCtrlr : public ISwitchItems
 {
     int zTarget;
     YArray<YFrameWindow*> zList;
+    // scratch space for ordering the list
+    YArray<YFrameWindow*> fFrames;
+    YArray<int> fKeys;
+    YArray<int> fBuckets;
     YWindowManager *fRoot;
     YFrameWindow *fActiveWindow;
     YFrameWindow *fLastWindow;
     char *fWMClass;
 
-    void append(YFrameWindow* w) {
-        if (find(zList, w) < 0) {
-            zList.append(w);
+    enum { Passes = 6 };
+
+    // The position of a window in the switch order as a pass number:
+    // 0: focused window
+    // 1: urgent windows
+    // 2: normal windows
+    // 3: minimized windows
+    // 4: hidden windows
+    // 5: unfocusable windows
+    // or -1 when the window is not switchable.
+    int switchPass(YFrameWindow* w) {
+        if (w->frameOption(YFrameWindow::foIgnoreQSwitch))
+            return -1;
+        else if (w == fRoot->getFocus())
+            return 0;
+        else if (w->isUrgent())
+            return quickSwitchToUrgent ? 1 : 2;
+        else if (w->avoidFocus())
+            return 5;
+        else if (w->isHidden())
+            return quickSwitchToHidden ? 4 : -1;
+        else if (w->isMinimized())
+            return quickSwitchToMinimized ? 3 : -1;
+        else
+            return 2;
+    }
+
+    // The workspace group of a window: the active workspace is first,
+    // then the others in order, or -1 when the window is not listed.
+    int switchGroup(YFrameWindow* w, int activeWorkspace) {
+        if (quickSwitchToAllWorkspaces && !quickSwitchGroupWorkspaces)
+            return 0;
+        if (w->isUrgent() || w->visibleOn(activeWorkspace))
+            return 0;
+        if (quickSwitchToAllWorkspaces == false)
+            return -1;
+        int ws = w->getWorkspace();
+        if (inrange(ws, 0, workspaceCount - 1))
+            return 1 + ws - (ws > activeWorkspace);
+        return -1;
+    }
+
+    // Order the windows by workspace group, then by pass, then by
+    // focus in one pass over the focus order and a counting sort.
+    void getZList() {
+        const int activeWorkspace = fRoot->activeWorkspace();
+        const int groups = max(1, int(workspaceCount));
+
+        fKeys.clear();
+        fFrames.clear();
+        fBuckets.clear();
+        fBuckets.setCapacity(groups * Passes + 1);
+        for (int i = 0; i <= groups * Passes; ++i)
+            fBuckets.append(0);
+
+        bool active = false, last = false;
+        for (YFrameIter iter = fRoot->focusedReverseIterator(); ++iter; ) {
+            YFrameWindow* w = iter;
+            if (hasbit(w->client()->winHints(), WinHintsSkipFocus))
+                continue;
+
+            if (!w->client()->adopted() && !w->visible())
+                continue;
+
+            if (nonempty(fWMClass)) {
+                if (w->client()->classHint()->match(fWMClass) == false)
+                    continue;
+            }
+
+            int group = switchGroup(w, activeWorkspace);
+            int pass = group < 0 ? -1 : switchPass(w);
+            if (pass < 0)
+                continue;
+
+            int key = group * Passes + pass;
+            fKeys.append(key);
+            fFrames.append(w);
+            fBuckets[key + 1] += 1;
+            active |= (w == fActiveWindow);
+            last |= (w == fLastWindow);
         }
-    }
 
-    void getZList() {
+        for (int i = 1; i < fBuckets.getCount(); ++i)
+            fBuckets[i] += fBuckets[i - 1];
 
-        if (quickSwitchGroupWorkspaces || !quickSwitchToAllWorkspaces) {
-            int activeWorkspace = fRoot->activeWorkspace();
-            GetZListWorkspace(true, activeWorkspace);
-            if (quickSwitchToAllWorkspaces) {
-                for (int w = 0; w < workspaceCount; ++w) {
-                    if (w != activeWorkspace)
-                        GetZListWorkspace(true, w);
-                }
-            }
-        } else
-            GetZListWorkspace(false, -1);
+        zList.setCapacity(fFrames.getCount());
+        for (int i = 0; i < fFrames.getCount(); ++i)
+            zList.append(nullptr);
+        for (int i = 0; i < fFrames.getCount(); ++i)
+            zList[fBuckets[fKeys[i]]++] = fFrames[i];
 
-        if (fActiveWindow != nullptr && find(zList, fActiveWindow) == -1)
+        if (active == false)
             fActiveWindow = nullptr;
-        if (fLastWindow != nullptr && find(zList, fLastWindow) == -1)
+        if (last == false)
             fLastWindow = nullptr;
     }
 
@@ -53,69 +128,6 @@ class WindowItemsCtrlr : public ISwitchItems
         zList.clear();
     }
 
-    void GetZListWorkspace(bool workspaceOnly, int workspace)
-    {
-        for (int pass = 0; pass <= 5; pass++) {
-            YFrameIter w = fRoot->focusedReverseIterator();
-
-            while (++w) {
-                // pass 0: focused window
-                // pass 1: urgent windows
-                // pass 2: normal windows
-                // pass 3: minimized windows
-                // pass 4: hidden windows
-                // pass 5: unfocusable windows
-
-                if (hasbit(w->client()->winHints(), WinHintsSkipFocus))
-                    continue;
-
-                if (!w->client()->adopted() && !w->visible()) {
-                    continue;
-                }
-
-                if (!w->isUrgent()) {
-                    if (workspaceOnly && w->isAllWorkspaces() &&
-                        workspace != fRoot->activeWorkspace()) {
-                        continue;
-                    }
-
-                    if (workspaceOnly && !w->visibleOn(workspace)) {
-                        continue;
-                    }
-                }
-
-                if (nonempty(fWMClass)) {
-                    if (w->client()->classHint()->match(fWMClass) == false)
-                        continue;
-                }
-
-                if (w->frameOption(YFrameWindow::foIgnoreQSwitch))
-                    ;
-                else if (w == fRoot->getFocus()) {
-                    if (pass == 0) append(w);
-                } else if (w->isUrgent()) {
-                    if (quickSwitchToUrgent) {
-                        if (pass == 1) append(w);
-                    } else {
-                        if (pass == 2) append(w);
-                    }
-                } else if (w->avoidFocus()) {
-                    if (pass == 5) append(w);
-                } else if (w->isHidden()) {
-                    if (pass == 4)
-                        if (quickSwitchToHidden)
-                            append(w);
-                } else if (w->isMinimized()) {
-                    if (pass == 3)
-                        if (quickSwitchToMinimized)
-                            append(w);
-                } else {
-                    if (pass == 2) append(w);
-                }
-            }
-        }
-    }
-
     void displayFocusChange(YFrameWindow *frame)  {
         manager->switchFocusTo(frame, false);
     }
@@ -245,8 +257,11 @@ public:
         YFrameWindow* frame = (YFrameWindow*) item;
         if (frame == fLastWindow)
             fLastWindow = nullptr;
+        // the order of the others is unchanged
         auto pos = zTarget;
-        updateList();
+        int index = find(zList, frame);
+        if (index >= 0)
+            zList.remove(index);
         setTarget( (pos >= 0 && pos < getCount()) ? pos : 0);
         displayFocusChange(fActiveWindow);
     }
@@ -502,8 +517,8 @@ void SwitchWindow::paintHorizontal(Graphics &g) {
                          YIcon::largeSize() : 0);
             int const dx(YIcon::largeSize() + 2 * quickSwitchIMargin);
 
-            const int visIcons((width() - 2 * quickSwitchHMargin) / dx);
-            int curIcon(-1);
+            const int visIcons(max(1, int(width() - 2 * quickSwitchHMargin) / dx));
+            const int curIcon(zItems->getActiveItem());
 
             int const y(quickSwitchTextFirst
                         ? height() - quickSwitchVMargin - iconSize - quickSwitchIMargin + ds / 2
@@ -518,43 +533,42 @@ void SwitchWindow::paintHorizontal(Graphics &g) {
             int x((width() - min(visIcons, zItems->getCount()) * dx - ds) /  2 +
                   quickSwitchIMargin);
 
-            m_hintAreaStart = x;
+            // the strip scrolls to keep the active item in view
+            m_hintAreaStart = x - off * dx;
             m_hintAreaStep = dx;
 
-            for (int i = 0, zCount = zItems->getCount (); i < zCount; i++) {
-                if (i >= off && i < end) {
-                    ref<YIcon> icon = zItems->getIcon(i);
-                    if (icon != null) {
-                        if (i == m_hlItemFromMotion && i != zItems->getActiveItem()) {
-                            g.setColor(frameColor.darker());
+            for (int i = off, zCount = min(end, zItems->getCount()); i < zCount; i++) {
+                ref<YIcon> icon = zItems->getIcon(i);
+                if (icon != null) {
+                    if (i == m_hlItemFromMotion && i != zItems->getActiveItem()) {
+                        g.setColor(frameColor.darker());
+                        g.drawRect(x - quickSwitchIBorder,
+                                y - quickSwitchIBorder - ds / 2,
+                                iconSize + 2 * quickSwitchIBorder,
+                                iconSize + 2 * quickSwitchIBorder);
+                        g.setColor(frameColor);
+                    }
+                    if (i == zItems->getActiveItem()) {
+                        if (quickSwitchFillSelection)
+                            g.fillRect(x - quickSwitchIBorder,
+                                    y - quickSwitchIBorder - ds / 2,
+                                    iconSize + 2 * quickSwitchIBorder,
+                                    iconSize + 2 * quickSwitchIBorder);
+                        else
                             g.drawRect(x - quickSwitchIBorder,
                                     y - quickSwitchIBorder - ds / 2,
                                     iconSize + 2 * quickSwitchIBorder,
                                     iconSize + 2 * quickSwitchIBorder);
-                            g.setColor(frameColor);
-                        }
-                        if (i == zItems->getActiveItem()) {
-                            if (quickSwitchFillSelection)
-                                g.fillRect(x - quickSwitchIBorder,
-                                        y - quickSwitchIBorder - ds / 2,
-                                        iconSize + 2 * quickSwitchIBorder,
-                                        iconSize + 2 * quickSwitchIBorder);
-                            else
-                                g.drawRect(x - quickSwitchIBorder,
-                                        y - quickSwitchIBorder - ds / 2,
-                                        iconSize + 2 * quickSwitchIBorder,
-                                        iconSize + 2 * quickSwitchIBorder);
-
-                            if (icon != null) {
-                                icon->draw(g, x, y - ds / 2, iconSize);
-                            }
-                        } else {
-                            icon->draw(g, x, y, YIcon::largeSize());
+
+                        if (icon != null) {
+                            icon->draw(g, x, y - ds / 2, iconSize);
                         }
-                        x += ds;
+                    } else {
+                        icon->draw(g, x, y, YIcon::largeSize());
                     }
-                    x += dx;
+                    x += ds;
                 }
+                x += dx;
             }
         }
     }
@@ -597,11 +611,18 @@ void SwitchWindow::paintVertical(Graphics &g) {
                 ? maxWid - iconSize - quickSwitchSepSize/2 - 1
                         :  contentX + iconSize + quickSwitchSepSize/2 - 1;
 
+        // scroll to keep the active item in view
+        const int rows = max(1, 1 + (int(height() - quickSwitchVMargin)
+                                     - frameHght) / m_hintAreaStep);
+        const int first = max(0, zItems->getActiveItem() - rows + 1);
+        m_hintAreaStart = quickSwitchVMargin - quickSwitchIBorder
+                        - first * m_hintAreaStep;
+
         int contentY = quickSwitchVMargin;
 
         g.setFont(switchFont);
         g.setColor(switchFg);
-        for (int i = 0, zCount = zItems->getCount(); i < zCount; i++) {
+        for (int i = first, zCount = zItems->getCount(); i < zCount; i++) {
             if (contentY + frameHght > (int) height())
                 break;
             if (i == zItems->getActiveItem()) {
@@ -96,6 +96,7 @@ private:
     bool isUp;
 
     bool modDown(int m);
+    static unsigned modifiers();
     bool isModKey(KeyCode c);
     void resize(int xiscreen);
 
@@ -193,15 +193,15 @@ void YFrameTitleBar::handleBeginDrag(
 }
 
 void YFrameTitleBar::activate() {
-    repaint();
+    invalidate();
     if (LOOK(lookPixmap | lookMetal | lookGtk | lookFlat)) {
         for (auto b : fButtons)
             if (b)
-                b->repaint();
+                b->invalidate();
     }
     else if (LOOK(lookWin95)) {
         if (menuButton())
-            menuButton()->repaint();
+            menuButton()->invalidate();
     }
 }
 
@@ -255,10 +255,10 @@ void YFrameTitleBar::deactivate() {
 }
 
 void YFrameTitleBar::refresh() {
-    repaint();
+    invalidate();
     for (auto b : fButtons)
         if (b)
-            b->repaint();
+            b->invalidate();
 }
 
 void YFrameTitleBar::repaint() {
@@ -6,6 +6,16 @@
 #include "ref.h"
 #include "ypaths.h"
 #include "ymenu.h"
+#include "yxapp.h"
+#include "ytrace.h"
+#include "ytime.h"
+#include "intl.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #define extern
 #include "wpixmaps.h"
@@ -59,7 +69,7 @@ public:
     bool needLoad() const {
         return (pixmapRef != nullptr) ? *pixmapRef == null : needImage();
     }
-    void loadFromFile(const upath& file) const;
+    void loadFromImage(ref<YImage> image) const;
     void reset() const {
         if (pixmapRef != nullptr) *pixmapRef = null;
         if (imageRef != nullptr) *imageRef = null;
@@ -82,13 +92,17 @@ private:
 
 };
 
-void PixmapResource::loadFromFile(const upath& file) const
+void PixmapResource::loadFromImage(ref<YImage> image) const
 {
+    if (image == null)
+        return;
     if (needPixmap()) {
-        *pixmapRef = YResourcePaths::loadPixmapFile(file);
+        ref<YPixmap> pixmap(YPixmap::createFromImage(image, xapp->depth()));
+        if (pixmap != null && pixmap->pixmap())
+            *pixmapRef = pixmap;
     }
-    if (needImage()) {
-        *imageRef = YResourcePaths::loadImageFile(file);
+    if (needImage() && image->valid()) {
+        *imageRef = image;
     }
 }
 
@@ -314,6 +328,102 @@ static const PixmapResource ledclockPixRes[] = {
     PixmapResource(ledPixPercent, "percent.xpm"),
 };
 
+// The resources are scanned twice. The first scan only chooses files,
+// which are decoded by a few threads where the image format permits.
+// The second scan assigns the images and decodes the remaining files.
+// Each file is decoded only once, even when several resources use it.
+class PixmapLoader {
+public:
+    PixmapLoader() : fPlanning(true), fThreads(0), fParallel(0) { }
+
+    bool wanted(const PixmapResource* res) const {
+        return res->needLoad() && (fPlanning == false || 0 == fChosen.count(res));
+    }
+    void load(const PixmapResource* res, const upath& file);
+    void decode();
+
+    int files() const { return int(fImages.size()); }
+    int parallel() const { return fParallel; }
+    int threads() const { return fThreads; }
+
+private:
+    struct Decoded {
+        ref<YImage> image;
+        bool done;
+    };
+
+    static ref<YImage> decodeFile(const char* path);
+
+    bool fPlanning;
+    int fThreads;
+    int fParallel;
+    std::unordered_set<const PixmapResource*> fChosen;
+    std::unordered_map<std::string, Decoded> fImages;
+    std::vector<std::string> fFiles;
+};
+
+ref<YImage> PixmapLoader::decodeFile(const char* path) {
+    upath file(path);
+    ref<YImage> image;
+    if (file.isReadable())
+        image = YImage::load(file);
+    if (image == null)
+        warn(_("Image not readable: %s"), path);
+    return image;
+}
+
+void PixmapLoader::load(const PixmapResource* res, const upath& file) {
+    upath copy(file);
+    std::string path(copy.string());
+    auto it = fImages.find(path);
+    if (it == fImages.end()) {
+        it = fImages.emplace(path, Decoded { null, false }).first;
+        fFiles.push_back(path);
+    }
+    if (fPlanning) {
+        fChosen.insert(res);
+        return;
+    }
+    if (it->second.done == false) {
+        it->second.image = decodeFile(path.c_str());
+        it->second.done = true;
+    }
+    res->loadFromImage(it->second.image);
+}
+
+void PixmapLoader::decode() {
+    fPlanning = false;
+
+    std::vector<const char*> jobs;
+    for (const std::string& path : fFiles)
+        if (YImage::loadsConcurrently(upath(path.c_str())))
+            jobs.push_back(path.c_str());
+    const int cores = int(std::thread::hardware_concurrency());
+    fThreads = min(min(int(jobs.size()), max(1, cores)), 8);
+    if (fThreads < 2)
+        return;
+
+    std::vector<ref<YImage>> images(jobs.size());
+    std::atomic<size_t> next(0);
+    auto work = [&] () {
+        for (size_t i; (i = next++) < jobs.size(); )
+            images[i] = decodeFile(jobs[i]);
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < fThreads; ++i)
+        pool.emplace_back(work);
+    work();
+    for (auto& thread : pool)
+        thread.join();
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        Decoded& dec = fImages[jobs[i]];
+        dec.image = images[i];
+        dec.done = true;
+    }
+    fParallel = int(jobs.size());
+}
+
 class PixmapsDescription {
 public:
     const PixmapResource *pixres;
@@ -323,9 +433,9 @@ public:
 
     int count() const { return (int) size; }
 
-    void load(const upath& file, const char *ent);
-    void altL(const upath& file, const char *ent);
-    void scan(const upath& path);
+    void load(const upath& file, const char *ent, PixmapLoader& loader);
+    void altL(const upath& file, const char *ent, PixmapLoader& loader);
+    void scan(const upath& path, PixmapLoader& loader);
 };
 
 static PixmapsDescription pixdes[] = {
@@ -336,23 +446,25 @@ static PixmapsDescription pixdes[] = {
     { ledclockPixRes, ACOUNT(ledclockPixRes), "ledclock", false },
 };
 
-void PixmapsDescription::load(const upath& file, const char *ent) {
+void PixmapsDescription::load(const upath& file, const char *ent,
+                              PixmapLoader& loader) {
     for (int i = 0; i < count(); ++i) {
         const PixmapResource *res = &pixres[i];
-        if (res->needLoad()) {
+        if (loader.wanted(res)) {
             if (res->nameEqual(ent)) {
-                res->loadFromFile(file);
+                loader.load(res, file);
             }
         }
     }
 }
 
-void PixmapsDescription::altL(const upath& file, const char *ent) {
+void PixmapsDescription::altL(const upath& file, const char *ent,
+                              PixmapLoader& loader) {
     for (int i = 0; i < count(); ++i) {
         const PixmapResource *res = &pixres[i];
-        if (res->needLoad()) {
+        if (loader.wanted(res)) {
             if (res->altEqual(ent)) {
-                res->loadFromFile(file);
+                loader.load(res, file);
             }
         }
     }
@@ -362,7 +474,7 @@ inline const char* extension(const char* filename) {
     return Elvis<const char*>(strrchr(filename, '.'), "");
 }
 
-void PixmapsDescription::scan(const upath& path) {
+void PixmapsDescription::scan(const upath& path, PixmapLoader& loader) {
     YStringArray xpm(80), png(80);
     upath subdir(path + this->subdir);
     for (cdir dir(subdir.string()); dir.next(); ) {
@@ -378,9 +490,9 @@ void PixmapsDescription::scan(const upath& path) {
         for (YStringArray::IterType iter = xpm.iterator(); ++iter; ) {
             upath file(subdir + *iter);
             if (loop == 0)
-                load(file, *iter);
+                load(file, *iter, loader);
             else
-                altL(file, *iter);
+                altL(file, *iter, loader);
         }
     }
     for (int loop = 0; loop < 2; ++loop) {
@@ -392,27 +504,44 @@ void PixmapsDescription::scan(const upath& path) {
             size_t len = strlen(copy);
             strlcpy(copy + len - 4, ".xpm", size - len + 4);
             if (loop == 0)
-                load(file, copy);
+                load(file, copy, loader);
             else
-                altL(file, copy);
+                altL(file, copy, loader);
         }
     }
 }
 
-static void loadPixmapResources() {
+static void scanPixmapResources(PixmapLoader& loader) {
     bool themeOnly = true;
     for (int k = 0; k < 2; ++k, themeOnly = !themeOnly) {
         ref<YResourcePaths> paths = YResourcePaths::subdirs(null, themeOnly);
         for (int i = 0; i < (int) ACOUNT(pixdes); ++i) {
             if (themeOnly == pixdes[i].themeOnly) {
                 for (int p = 0; p < paths->getCount(); ++p) {
-                    pixdes[i].scan(paths->getPath(p));
+                    pixdes[i].scan(paths->getPath(p), loader);
                 }
             }
         }
     }
 }
 
+static void loadPixmapResources() {
+    timeval start = monotime();
+    PixmapLoader loader;
+    scanPixmapResources(loader);
+    loader.decode();
+    timeval decoded = monotime();
+    scanPixmapResources(loader);
+
+    if (YTrace::traces("theme")) {
+        timeval now = monotime();
+        tlog("theme: %d images, %d decoded by %d threads in %.1f ms, "
+             "total %.1f ms", loader.files(), loader.parallel(),
+             loader.threads(), 1e3 * toDouble(decoded - start),
+             1e3 * toDouble(now - start));
+    }
+}
+
 static void freePixmapResources() {
     for (int i = 0; i < (int) ACOUNT(pixdes); ++i) {
         for (int k = 0; k < pixdes[i].count(); ++k) {
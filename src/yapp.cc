@@ -10,6 +10,7 @@
 #include "yprefs.h"
 #include "sysdep.h"
 #include "intl.h"
+#include "yspawn.h"
 
 //#define USE_SIGNALFD
 
@@ -392,30 +393,21 @@ int YApplication::runProgram(const char *path, const char *const *args) {
     flushXEvents();
 
     int cpid = -1;
-    if (path && (cpid = fork()) == 0) {
-        resetSignals();
-        sigemptyset(&signalMask);
-        sigaddset(&signalMask, SIGHUP);
-        sigprocmask(SIG_UNBLOCK, &signalMask, nullptr);
+    if (path) {
+        // the child has the signal mask from before we blocked signals
+        sigset_t mask = oldSignalMask;
+        sigdelset(&mask, SIGHUP);
 
         /* perhaps the right thing to to:
          create ptys .. and show console window when an application
          attempts to use it (how do we detect input with no output?) */
-        setsid();
-#if 0
-        close(0);
-        if (open("/dev/null", O_RDONLY) != 0)
-            _exit(1);
-#endif
-        closeFiles();
-
-        if (args)
-            execvp(path, const_cast<char **>(args));
-        else
-            execlp(path, path, nullptr);
+        YSpawn spawn;
+        spawn.signalMask(mask);
+        spawn.newSession();
 
-        fail(_("Failed to execute %s"), path);
-        _exit(99);
+        cpid = spawn.spawn(path, args, true);
+        if (cpid == -1)
+            fail(_("Failed to execute %s"), path);
     }
     return cpid;
 }
@@ -506,6 +498,24 @@ const upath& YApplication::getPrivConfDir() {
     return dir;
 }
 
+const upath& YApplication::getCacheDir() {
+    static upath dir;
+    if (dir.isEmpty()) {
+        const char *env = getenv("XDG_CACHE_HOME");
+        if (nonempty(env))
+            dir = env;
+        else
+            dir = getHomeDir() + "/.cache";
+        if ( ! dir.dirExists())
+            dir.mkdir();
+        dir += "/icewm";
+        if ( ! dir.dirExists())
+            dir.mkdir();
+        MSG(("using %s for cache files", dir.string()));
+    }
+    return dir;
+}
+
 upath YApplication::getHomeDir() {
     char *env = getenv("HOME");
     if (nonempty(env)) {
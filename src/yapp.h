@@ -59,6 +59,7 @@ public:
     static const upath& getLibDir();
     static const upath& getConfigDir();
     static const upath& getPrivConfDir();
+    static const upath& getCacheDir();
     static upath getHomeDir();
 
 private:
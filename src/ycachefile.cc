@@ -0,0 +1,97 @@
+/*
+ * IceWM
+ *
+ * Common parts of the cache files.
+ */
+#include "config.h"
+#include "ycachefile.h"
+#include "upath.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+uint64_t fnvHash(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    return hash;
+}
+
+uint64_t fnvHash(uint64_t hash, const char* str) {
+    if (str == nullptr)
+        str = "";
+    return fnvHash(hash, str, strlen(str) + 1);
+}
+
+// Write all of data, also after partial writes and interrupts.
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t done = write(fd, data, size);
+        if (done > 0) {
+            data += done;
+            size -= size_t(done);
+        }
+        else if (done == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool replaceFile(upath dest, const void* data, size_t size) {
+    // a unique name, because threads may write the same destination
+    mstring name(dest.path() + ".XXXXXX");
+    std::vector<char> temp(name.c_str(), name.c_str() + name.length() + 1);
+    int fd = mkstemp(temp.data());
+    if (fd == -1)
+        return false;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    bool written = writeAll(fd, static_cast<const char *>(data), size);
+    if (close(fd))
+        written = false;
+    if (written == false || rename(temp.data(), dest.string())) {
+        unlink(temp.data());
+        return false;
+    }
+    return true;
+}
+
+bool YCacheMap::map(upath path, const char* magic, size_t minimum) {
+    unmap();
+
+    int fd = path.open(O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= minimum &&
+        size_t(st.st_size) >= size_t(MagicSize))
+    {
+        void* map = mmap(nullptr, size_t(st.st_size), PROT_READ,
+                         MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            fData = static_cast<const char *>(map);
+            fSize = size_t(st.st_size);
+            if (memcmp(fData, magic, MagicSize))
+                unmap();
+        }
+    }
+    close(fd);
+    return fData != nullptr;
+}
+
+void YCacheMap::unmap() {
+    if (fData)
+        munmap(const_cast<char *>(fData), fSize);
+    fData = nullptr;
+    fSize = 0;
+}
+
+// vim: set sw=4 ts=4 et:
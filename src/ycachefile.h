@@ -0,0 +1,51 @@
+#ifndef YCACHEFILE_H
+#define YCACHEFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class upath;
+
+// The start value of an FNV-1a hash.
+const uint64_t fnvOffset = 14695981039346656037ULL;
+
+// Continue an FNV-1a hash with length bytes of data.
+uint64_t fnvHash(uint64_t hash, const void* data, size_t length);
+
+// Continue an FNV-1a hash with a string and its terminating zero,
+// where null is hashed like the empty string.
+uint64_t fnvHash(uint64_t hash, const char* str);
+
+// Write a file under a temporary name and then rename it,
+// so that readers see either the old or the complete new file.
+bool replaceFile(upath dest, const void* data, size_t size);
+
+/*
+ * A read-only mapping of a cache file. The file must start with
+ * an eight byte magic, which identifies the kind and the version
+ * of its format, and it must have a minimum size.
+ */
+class YCacheMap {
+public:
+    YCacheMap() : fData(nullptr), fSize(0) { }
+    ~YCacheMap() { unmap(); }
+
+    bool map(upath path, const char* magic, size_t minimum);
+    void unmap();
+
+    const char* data() const { return fData; }
+    size_t size() const { return fSize; }
+
+    enum { MagicSize = 8 };
+
+private:
+    const char* fData;
+    size_t fSize;
+
+    YCacheMap(const YCacheMap&);
+    YCacheMap& operator=(const YCacheMap&);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
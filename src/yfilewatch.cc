@@ -0,0 +1,324 @@
+/*
+ * IceWM
+ *
+ * Notification of changes to configuration files and folders.
+ */
+#include "config.h"
+#include "yfilewatch.h"
+#include "ypoll.h"
+#include "ytimer.h"
+#include "yapp.h"
+#include "debug.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+// how long to wait for more events before notifying the listeners
+#define SETTLE_DELAY_MS 250
+// how often paths are checked when inotify can not be used
+#define POLL_INTERVAL_MS 3000
+
+#ifdef HAVE_SYS_INOTIFY_H
+static const unsigned watchMask =
+    IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+    IN_DELETE_SELF | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO |
+    IN_ONLYDIR;
+#endif
+
+/*
+ * Inotify watches folders: for a file its folder is watched and
+ * the events are filtered by name. When a folder does not exist
+ * the nearest existing parent folder is watched until it appears.
+ */
+class YFileWatcher: public YPollBase, private YTimerListener {
+public:
+    static YFileWatcher* instance();
+
+    void add(YFileWatch* watch, const std::string& path);
+    void remove(YFileWatch* watch);
+
+private:
+    struct Stamp {
+        time_t mtime;
+        off_t size;
+        ino_t ino;
+        bool exists;
+
+        void take(const std::string& path);
+        bool operator!=(const Stamp& o) const {
+            return exists != o.exists || mtime != o.mtime ||
+                   size != o.size || ino != o.ino;
+        }
+    };
+    struct Entry {
+        YFileWatch* watch;
+        std::string path;   // what the owner asked for
+        std::string name;   // entry of the watched folder, or empty for all
+        int wd;             // inotify watch, or -1 when polled
+        bool exact;         // wd is on path or on its folder
+        Stamp stamp;        // when polled
+    };
+
+    YFileWatcher();
+    ~YFileWatcher();
+
+    void arm(Entry& entry);
+    void release(int wd);
+    void changed(YFileWatch* watch);
+
+    virtual void notifyRead();
+    virtual bool forRead() { return true; }
+    virtual bool handleTimer(YTimer* timer);
+
+    std::vector<Entry> fEntries;
+    std::vector<YFileWatch*> fChanged;
+    YTimer fSettle;
+    YTimer fPoll;
+    bool fNotifying;
+
+    YFileWatcher(const YFileWatcher&);
+    YFileWatcher& operator=(const YFileWatcher&);
+};
+
+static YFileWatcher* fileWatcher;
+
+static std::string dirName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string()
+         : slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+static std::string baseName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void YFileWatcher::Stamp::take(const std::string& path) {
+    struct stat st;
+    exists = (stat(path.c_str(), &st) == 0);
+    mtime = exists ? st.st_mtime : 0;
+    size = exists ? st.st_size : 0;
+    ino = exists ? st.st_ino : 0;
+}
+
+YFileWatcher* YFileWatcher::instance() {
+    if (fileWatcher == nullptr)
+        fileWatcher = new YFileWatcher();
+    return fileWatcher;
+}
+
+YFileWatcher::YFileWatcher() :
+    YPollBase(),
+    fSettle(SETTLE_DELAY_MS, this, false),
+    fPoll(POLL_INTERVAL_MS, this, false),
+    fNotifying(false)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    int fd = inotify_init();
+    if (fd >= 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        registerPoll(fd);
+    } else {
+        TLOG(("inotify: %s", strerror(errno)));
+    }
+#endif
+}
+
+YFileWatcher::~YFileWatcher() {
+    closePoll();
+}
+
+void YFileWatcher::add(YFileWatch* watch, const std::string& path) {
+    for (const Entry& entry : fEntries)
+        if (entry.watch == watch && entry.path == path)
+            return;
+
+    Entry entry;
+    entry.watch = watch;
+    entry.path = path;
+    entry.wd = -1;
+    entry.exact = true;
+    arm(entry);
+    fEntries.push_back(entry);
+}
+
+void YFileWatcher::remove(YFileWatch* watch) {
+    for (size_t i = fEntries.size(); i-- > 0; ) {
+        if (fEntries[i].watch == watch) {
+            int wd = fEntries[i].wd;
+            fEntries.erase(fEntries.begin() + i);
+            release(wd);
+        }
+    }
+    fChanged.erase(std::remove(fChanged.begin(), fChanged.end(), watch),
+                   fChanged.end());
+
+    if (fEntries.empty() && fNotifying == false) {
+        fileWatcher = nullptr;
+        delete this;
+    }
+}
+
+void YFileWatcher::arm(Entry& entry) {
+    int previous = entry.wd;
+    entry.wd = -1;
+    entry.exact = true;
+    entry.stamp.take(entry.path);
+
+#ifdef HAVE_SYS_INOTIFY_H
+    std::string folder(entry.path);
+    entry.name.clear();
+    struct stat st;
+    if (stat(folder.c_str(), &st) != 0 || S_ISDIR(st.st_mode) == false) {
+        entry.name = baseName(folder);
+        folder = dirName(folder);
+    }
+    while (fd() >= 0 && folder.empty() == false) {
+        entry.wd = inotify_add_watch(fd(), folder.c_str(), watchMask);
+        if (entry.wd >= 0 || (errno != ENOENT && errno != ENOTDIR))
+            break;
+        if (folder == "/")
+            break;
+        entry.name = baseName(folder);
+        entry.exact = false;
+        folder = dirName(folder);
+    }
+    MSG(("watch %s as %d for %s", entry.path.c_str(), entry.wd,
+         entry.name.c_str()));
+#endif
+
+    if (previous >= 0 && previous != entry.wd)
+        release(previous);
+    if (entry.wd < 0 && fPoll.isRunning() == false)
+        fPoll.startTimer();
+}
+
+void YFileWatcher::release(int wd) {
+#ifdef HAVE_SYS_INOTIFY_H
+    if (wd < 0 || fd() < 0)
+        return;
+    for (const Entry& entry : fEntries)
+        if (entry.wd == wd)
+            return;
+    inotify_rm_watch(fd(), wd);
+#endif
+}
+
+void YFileWatcher::changed(YFileWatch* watch) {
+    if (std::find(fChanged.begin(), fChanged.end(), watch) == fChanged.end())
+        fChanged.push_back(watch);
+    if (fSettle.isRunning() == false)
+        fSettle.startTimer();
+}
+
+void YFileWatcher::notifyRead() {
+#ifdef HAVE_SYS_INOTIFY_H
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    std::vector<size_t> rearm;
+    ssize_t len;
+
+    while ((len = read(fd(), buf, sizeof buf)) > 0) {
+        for (char* ptr = buf; ptr < buf + len; ) {
+            const inotify_event* event =
+                reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            const bool overflow = (event->mask & IN_Q_OVERFLOW);
+            const bool gone = (event->mask &
+                               (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF));
+            for (size_t i = 0; i < fEntries.size(); ++i) {
+                Entry& entry = fEntries[i];
+                if (overflow == false && entry.wd != event->wd)
+                    continue;
+                bool hit = overflow || gone || entry.name.empty() ||
+                    (event->len && entry.name == event->name);
+                if (hit) {
+                    changed(entry.watch);
+                    if (overflow || gone || entry.exact == false)
+                        rearm.push_back(i);
+                }
+            }
+        }
+    }
+
+    std::sort(rearm.begin(), rearm.end());
+    rearm.erase(std::unique(rearm.begin(), rearm.end()), rearm.end());
+    for (size_t i : rearm)
+        arm(fEntries[i]);
+#endif
+}
+
+bool YFileWatcher::handleTimer(YTimer* timer) {
+    if (timer == &fPoll) {
+        bool polling = false;
+        for (Entry& entry : fEntries) {
+            if (entry.wd < 0) {
+                Stamp stamp;
+                stamp.take(entry.path);
+                if (stamp != entry.stamp) {
+                    entry.stamp = stamp;
+                    changed(entry.watch);
+                }
+                polling = true;
+            }
+        }
+        return polling;
+    }
+    if (timer == &fSettle) {
+        // a listener may change any watch, including its own
+        fNotifying = true;
+        while (fChanged.empty() == false) {
+            YFileWatch* watch = fChanged[0];
+            fChanged.erase(fChanged.begin());
+            watch->listener()->handleFileChange(watch);
+        }
+        fNotifying = false;
+        if (fEntries.empty()) {
+            fileWatcher = nullptr;
+            delete this;
+        }
+    }
+    return false;
+}
+
+YFileWatch::YFileWatch(YFileWatchListener* listener) :
+    fListener(listener)
+{
+}
+
+YFileWatch::~YFileWatch() {
+    clear();
+}
+
+void YFileWatch::add(upath path) {
+    if (path != null)
+        YFileWatcher::instance()->add(this, path.string());
+}
+
+void YFileWatch::addConfig(upath name) {
+    if (name.isAbsolute()) {
+        // like findConfigFile, watch the file after expansion
+        add(name.expand());
+    } else {
+        add(YApplication::getPrivConfDir() + name);
+        add(YApplication::getConfigDir() + name);
+        add(YApplication::getLibDir() + name);
+    }
+}
+
+void YFileWatch::clear() {
+    if (fileWatcher)
+        fileWatcher->remove(this);
+}
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,45 @@
+#ifndef YFILEWATCH_H
+#define YFILEWATCH_H
+
+#include "upath.h"
+
+class YFileWatch;
+
+class YFileWatchListener {
+public:
+    virtual void handleFileChange(YFileWatch* watch) = 0;
+protected:
+    virtual ~YFileWatchListener() {}
+};
+
+/*
+ * A set of files and folders for one listener, which is notified
+ * shortly after any of them is created, modified, replaced or removed.
+ * For a folder only changes to its entries count. Changes are reported
+ * by inotify where it is available, otherwise the paths are polled.
+ * All of this happens in the main loop.
+ */
+class YFileWatch {
+public:
+    explicit YFileWatch(YFileWatchListener* listener);
+    ~YFileWatch();
+
+    // Watch a file or a folder, which need not exist yet.
+    void add(upath path);
+    // Watch the places where findConfigFile looks for a relative name.
+    void addConfig(upath name);
+    // Forget all paths.
+    void clear();
+
+    YFileWatchListener* listener() const { return fListener; }
+
+private:
+    YFileWatchListener* fListener;
+
+    YFileWatch(const YFileWatch&);
+    YFileWatch& operator=(const YFileWatch&);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
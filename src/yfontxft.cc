@@ -61,10 +61,61 @@ private:
         unsigned width;
     };
 
+    // An LRU cache of the widths of measured text.
+    class TextCache {
+    public:
+        struct Entry {
+            unsigned long hash;
+            char * text;
+            int length;
+            int width;
+            Entry * chain;
+            Entry * older;
+            Entry * newer;
+        };
+
+        TextCache();
+        ~TextCache();
+
+        static unsigned long hash(char const * str, int len);
+        Entry * find(char const * str, int len, unsigned long hash);
+        Entry * insert(char const * str, int len, unsigned long hash,
+                       int width);
+
+    private:
+        enum { Capacity = 1024, Buckets = 1024 };
+
+        Entry * fEntries;
+        Entry * fBuckets[Buckets];
+        Entry * fNewest;
+        Entry * fOldest;
+        int fCount;
+
+        void unlink(Entry * entry);
+        void unchain(Entry * entry);
+        void link(Entry * entry);
+
+        TextCache(const TextCache&) = delete;
+        TextCache& operator=(const TextCache&) = delete;
+    };
+
+    // Which font draws a character: fFontCount if none of them has it.
+    struct FontSlot {
+        unsigned code;
+        unsigned font;
+    };
+    enum { FontSlots = 256 };
+
     TextPart * partitions(char_t * str, size_t len, size_t nparts = 0) const;
+    bool primaryAscii(char const * str, int len) const;
+    unsigned fontIndex(char_t c) const;
+    int decode(char const * str, int len, char_t * buf) const;
 
     unsigned fFontCount, fAscent, fDescent;
     XftFont ** fFonts;
+    unsigned fAsciiGlyphs[4];
+    mutable FontSlot fSlots[FontSlots];
+    mutable TextCache fCache;
 };
 
 class XftGraphics {
@@ -72,53 +123,33 @@ public:
 #ifdef CONFIG_I18N
     typedef XftChar32 char_t;
 
-    #define XftDrawString XftDrawString32
     #define XftTextExtents XftTextExtents32
 #else
     typedef XftChar8 char_t;
 
     #define XftTextExtents XftTextExtents8
-    #define XftDrawString XftDrawString8
 #endif
 
-    static void drawString(Graphics &g, XftFont * font, int x, int y,
-                           char_t * str, size_t len)
-    {
-#ifdef CONFIG_FRIBIDI
-        const size_t bufsize = 256;
-        char_t buf[bufsize];
-        char_t *vis_str = buf;
-        asmart<char_t> big;
-
-        if (len >= bufsize) {
-            big = new char_t[len+1];
-            if (big == nullptr)
-                return;
-            vis_str = big;
-        }
+    static void textExtents(XftFont * font, char_t * str, size_t len,
+                            XGlyphInfo & extends) {
+        XftTextExtents(xapp->display(), font, str, len, &extends);
+    }
 
+#ifdef CONFIG_FRIBIDI
+    // Reorder from logical to visual order into vis.
+    static char_t * reorder(char_t * str, size_t len, char_t * vis) {
         FriBidiCharType pbase_dir = FRIBIDI_TYPE_N;
 
         if (fribidi_log2vis(str, len, &pbase_dir, //input
-                            vis_str, // output
+                            vis, // output
                             nullptr, nullptr, nullptr // "statistics" that we don't need
                             ))
         {
-            str = vis_str;
+            return vis;
         }
-#endif
-
-        XftDrawString(g.handleXft(), g.color().xftColor(), font,
-                      x - g.xorigin(),
-                      y - g.yorigin(),
-                      str, len);
+        return str;
     }
-
-    static void textExtents(XftFont * font, char_t * str, size_t len,
-                            XGlyphInfo & extends) {
-        XftTextExtents(xapp->display(), font, str, len, &extends);
-    }
-
+#endif
 };
 
 /******************************************************************************/
@@ -186,6 +217,17 @@ YXftFont::YXftFont(mstring name, bool use_xlfd, bool /*antialias*/):
         } else
             warn(_("Loading of fallback font \"%s\" failed."), "sans-serif");
     }
+
+    for (FontSlot& slot : fSlots)
+        slot.code = ~0U;
+
+    memset(fAsciiGlyphs, 0, sizeof fAsciiGlyphs);
+    if (fFontCount > 0) {
+        for (unsigned c = ' '; c < 0x7F; ++c) {
+            if (XftGlyphExists(xapp->display(), fFonts[0], c))
+                fAsciiGlyphs[c / 32] |= 1U << (c % 32);
+        }
+    }
 }
 
 YXftFont::~YXftFont() {
@@ -215,58 +257,218 @@ int YXftFont::textWidth(string_t const & text) const {
 }
 
 int YXftFont::textWidth(char const * str, int len) const {
-    return textWidth(string_t(str, len));
+    if (len <= 0 || fFontCount == 0)
+        return 0;
+
+    unsigned long hash = TextCache::hash(str, len);
+    TextCache::Entry * entry = fCache.find(str, len, hash);
+    if (entry)
+        return entry->width;
+
+    int width = 0;
+    if (primaryAscii(str, len)) {
+        XGlyphInfo extents;
+        XftTextExtents8(xapp->display(), fFonts[0],
+                        (FcChar8 const *) str, len, &extents);
+        width = extents.xOff;
+    }
+    else {
+        string_t text(str, len);
+        width = textWidth(text);
+    }
+    fCache.insert(str, len, hash, width);
+    return width;
 }
 
-void YXftFont::drawGlyphs(Graphics & graphics, int x, int y,
-                          char const * str, int len) {
-    string_t xtext(str, len);
-    if (0 == xtext.length()) return;
+// Whether all characters are printable ASCII with glyphs in the first font.
+bool YXftFont::primaryAscii(char const * str, int len) const {
+    for (int i = 0; i < len; ++i) {
+        unsigned c = (unsigned char) str[i];
+        if (c < ' ' || c >= 0x7F || !(fAsciiGlyphs[c / 32] & (1U << (c % 32))))
+            return false;
+    }
+    return true;
+}
 
-    int const y0(y - ascent());
-    int const gcFn(graphics.function());
+unsigned YXftFont::fontIndex(char_t c) const {
+    FontSlot& slot = fSlots[c % FontSlots];
+    if (slot.code != c) {
+        unsigned k = 0;
+        while (k < fFontCount && !XftGlyphExists(xapp->display(), fFonts[k], c))
+            ++k;
+        slot.code = c;
+        slot.font = k;
+    }
+    return slot.font;
+}
 
-    char_t * xstr((char_t *) xtext.data());
-    size_t xlen(xtext.length());
+// Convert to characters without allocation; buf must hold len characters.
+int YXftFont::decode(char const * str, int len, char_t * buf) const {
+    int i = 0;
+    while (i < len && (unsigned char) str[i] < 0x80) {
+        buf[i] = (unsigned char) str[i];
+        ++i;
+    }
+    if (i < len) {
+#ifdef CONFIG_I18N
+        i += YLocale::unicodeString(str + i, len - i, (YUChar *) buf + i, len - i);
+#else
+        for (; i < len; ++i)
+            buf[i] = (unsigned char) str[i];
+#endif
+    }
+    return i;
+}
 
-    TextPart *parts = partitions(xstr, xlen);
-///    unsigned w(0);
-///    unsigned const h(height());
+/******************************************************************************/
 
-///    for (TextPart *p = parts; p && p->length; ++p) w+= p->width;
+YXftFont::TextCache::TextCache() :
+    fEntries(nullptr),
+    fNewest(nullptr),
+    fOldest(nullptr),
+    fCount(0)
+{
+    memset(fBuckets, 0, sizeof fBuckets);
+}
+
+YXftFont::TextCache::~TextCache() {
+    for (int i = 0; i < fCount; ++i) {
+        delete[] fEntries[i].text;
+    }
+    delete[] fEntries;
+}
 
-///    YPixmap *pixmap = new YPixmap(w, h);
-///    Graphics canvas(*pixmap, 0, 0);
-//    XftGraphics textarea(graphics, xapp->visual(), xapp->colormap());
+unsigned long YXftFont::TextCache::hash(char const * str, int len) {
+    unsigned long hash = 5381;
+    for (int i = 0; i < len; ++i)
+        hash = 33 * hash ^ (unsigned char) str[i];
+    return hash;
+}
 
-    switch (gcFn) {
-        case GXxor:
-///         textarea.drawRect(*YColor::black, 0, 0, w, h);
-            break;
+YXftFont::TextCache::Entry *
+YXftFont::TextCache::find(char const * str, int len, unsigned long hash) {
+    for (Entry * e = fBuckets[hash % Buckets]; e; e = e->chain) {
+        if (e->hash == hash && e->length == len &&
+            memcmp(e->text, str, len) == 0)
+        {
+            if (e != fNewest) {
+                unlink(e);
+                link(e);
+            }
+            return e;
+        }
+    }
+    return nullptr;
+}
 
-        case GXcopy:
-///            canvas.copyDrawable(graphics.drawable(),
-///                                x - graphics.xorigin(), y0 - graphics.yorigin(), w, h, 0, 0);
-            break;
+YXftFont::TextCache::Entry *
+YXftFont::TextCache::insert(char const * str, int len, unsigned long hash,
+                            int width)
+{
+    Entry * e;
+    if (fEntries == nullptr)
+        fEntries = new Entry[Capacity];
+    if (fCount < Capacity) {
+        e = &fEntries[fCount++];
+    } else {
+        e = fOldest;
+        unlink(e);
+        unchain(e);
+        delete[] e->text;
     }
+    e->hash = hash;
+    e->text = new char[len];
+    memcpy(e->text, str, len);
+    e->length = len;
+    e->width = width;
+    e->chain = fBuckets[hash % Buckets];
+    fBuckets[hash % Buckets] = e;
+    link(e);
+    return e;
+}
 
+void YXftFont::TextCache::link(Entry * e) {
+    e->older = fNewest;
+    e->newer = nullptr;
+    if (fNewest)
+        fNewest->newer = e;
+    else
+        fOldest = e;
+    fNewest = e;
+}
+
+void YXftFont::TextCache::unlink(Entry * e) {
+    if (e->newer)
+        e->newer->older = e->older;
+    else
+        fNewest = e->older;
+    if (e->older)
+        e->older->newer = e->newer;
+    else
+        fOldest = e->newer;
+}
 
-    int xpos(0);
-    for (TextPart *p = parts; p && p->length; ++p) {
-        if (p->font) {
-            XftGraphics::drawString(graphics, p->font,
-                                    xpos + x, ascent() + y0,
-                                    xstr, p->length);
+void YXftFont::TextCache::unchain(Entry * e) {
+    for (Entry ** p = &fBuckets[e->hash % Buckets]; *p; p = &(*p)->chain) {
+        if (*p == e) {
+            *p = e->chain;
+            break;
         }
+    }
+}
 
-        xstr += p->length;
-        xpos += p->width;
+void YXftFont::drawGlyphs(Graphics & graphics, int x, int y,
+                          char const * str, int len) {
+    if (len <= 0 || fFontCount == 0)
+        return;
+
+    // Nearly all strings fit in these; only very long ones use the heap.
+    enum { Stack = 256 };
+    char_t chars[Stack];
+    XftGlyphFontSpec specs[Stack];
+    asmart<char_t> bigChars;
+    asmart<XftGlyphFontSpec> bigSpecs;
+    char_t * text = chars;
+    XftGlyphFontSpec * spec = specs;
+    if (len > Stack) {
+        text = bigChars = new char_t[len];
+        spec = bigSpecs = new XftGlyphFontSpec[len];
     }
 
-    delete[] parts;
+    int count = decode(str, len, text);
+
+#ifdef CONFIG_FRIBIDI
+    char_t visual[Stack];
+    asmart<char_t> bigVisual;
+    char_t * vis = visual;
+    if (count > Stack)
+        vis = bigVisual = new char_t[count];
+    text = XftGraphics::reorder(text, count, vis);
+#endif
 
-///    graphics.copyDrawable(canvas.drawable(), 0, 0, w, h, x, y0);
-///    delete pixmap;
+    Display * display = xapp->display();
+    int xpos = x - graphics.xorigin();
+    int ypos = y - graphics.yorigin();
+    int glyphs = 0;
+    for (int i = 0; i < count; ++i) {
+        unsigned k = fontIndex(text[i]);
+        if (k < fFontCount) {
+            XftFont * font = fFonts[k];
+            FT_UInt glyph = XftCharIndex(display, font, text[i]);
+            XGlyphInfo extents;
+            XftGlyphExtents(display, font, &glyph, 1, &extents);
+            spec[glyphs].font = font;
+            spec[glyphs].glyph = glyph;
+            spec[glyphs].x = short(xpos);
+            spec[glyphs].y = short(ypos);
+            xpos += extents.xOff;
+            ++glyphs;
+        }
+    }
+
+    if (glyphs)
+        XftDrawGlyphFontSpec(graphics.handleXft(), graphics.color().xftColor(),
+                             spec, glyphs);
 }
 
 bool YXftFont::supports(unsigned utf32char) {
@@ -293,10 +495,7 @@ YXftFont::TextPart * YXftFont::partitions(char_t * str, size_t len,
         return nullptr;
 
     for (char_t * endptr(str + len); c < endptr; ++c) {
-        XftFont ** probe(fFonts);
-
-        while (probe < lFont && !XftGlyphExists(xapp->display(), *probe, *c))
-            ++probe;
+        XftFont ** probe(fFonts + fontIndex(*c));
 
         if (probe != font) {
             if (nullptr != font) {
@@ -14,15 +14,23 @@
 #include "ypaths.h"
 #include "ypointer.h"
 #include "ywordexp.h"
+#include "udir.h"
+#include "yiconcache.h"
+#include "yiconloader.h"
 
 #include "intl.h"
 
 #include <fnmatch.h>
+#include <time.h>
 
 #include <vector>
 #include <initializer_list>
 #include <functional>
+#include <list>
 #include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 // place holder for scalable category, a size beyond normal limits
 #define SCALABLE 9000
@@ -104,6 +112,67 @@ static void iterUniqueSizeRev(std::function<bool(unsigned)> f, unsigned toSkip)
     }
 }
 
+// The file names in one icon folder. They are read once and read
+// again when the modification time of the folder has changed.
+// Until then a valid icon cache file answers for the folder.
+class IconDirectory {
+public:
+    IconDirectory(const mstring& path, unsigned index) :
+        fPath(path), fModified(0), fRead(0), fCheck(0),
+        fCache(nullptr), fIndex(index) { }
+
+    void attach(const YIconCache* cache) {
+        if (cache->valid()) {
+            fCache = cache;
+            fModified = cache->modified(fIndex);
+            fRead = cache->written();
+            fCheck = time(nullptr);
+        }
+    }
+
+    bool contains(mstring name) {
+        if (name.indexOf('/') >= 0)
+            return upath(fPath + name).fileExists();
+
+        time_t now = time(nullptr);
+        if (fCheck + 5 <= now) {
+            fCheck = now;
+            struct stat st;
+            if (upath(fPath).stat(&st) != 0) {
+                fNames.clear();
+                fModified = fRead = 0;
+                fCache = nullptr;
+            }
+            // a change in the second of reading may have been missed
+            else if (st.st_mtime != fModified || fModified >= fRead) {
+                fCache = nullptr;
+                read();
+                fModified = st.st_mtime;
+                fRead = now;
+            }
+        }
+        if (fCache)
+            return fCache->contains(fIndex, name.c_str());
+        return fNames.count(name.c_str());
+    }
+
+private:
+    void read() {
+        fNames.clear();
+        for (cdir dir(fPath.c_str()); dir.next(); )
+            fNames.emplace(dir.entry());
+        MSG(("indexed %d icon files in %s", int(fNames.size()), fPath.c_str()));
+    }
+
+    mstring fPath;
+    time_t fModified;
+    time_t fRead;
+    time_t fCheck;
+    const YIconCache* fCache;
+    unsigned fIndex;
+    std::unordered_set<std::string> fNames;
+};
+
 class IconPathIndex {
 public:
     struct IconCategory {
@@ -136,13 +205,28 @@ public:
         }
     } pools[2]; // zero are resource folders, one is based on IconPath
 
+    // file names of all the registered folders, to avoid many stat calls
+    std::unordered_map<std::string, IconDirectory> directories;
+    std::vector<YIconCache::Folder> folderList;
+    YIconCache cache;
+
+    bool present(mstring folder, const mstring& name) {
+        auto it = directories.find(folder.c_str());
+        if (it != directories.end())
+            return it->second.contains(name);
+        return upath(folder + name).fileExists();
+    }
+
     IconPathIndex() {
         std::set<mstring> dedupTestPath;
-        auto add = [&dedupTestPath](IconCategory& cat,
+        auto add = [this, &dedupTestPath](IconCategory& cat,
                 IconCategory::entry&& el) {
 
             if (dedupTestPath.insert(el.path).second) {
                 MSG(("adding specific icon directory: %s", el.path.c_str()));
+                directories.emplace(el.path.c_str(),
+                    IconDirectory(el.path, unsigned(folderList.size())));
+                folderList.push_back(YIconCache::Folder { el.path, cat.size });
                 cat.folders.emplace_back(std::move(el));
             }
         };
@@ -320,6 +404,10 @@ public:
 
             probeIconFolder(itok, false);
         }
+
+        cache.load(folderList);
+        for (auto& it : directories)
+            it.second.attach(&cache);
     }
 
     upath locateIcon(int size, mstring baseName, bool fromResources) {
@@ -330,32 +418,29 @@ public:
         // for compaction reasons, the lambdas return true on success,
         // but the success is only found in _this_ lambda only,
         // and this is the only one which touches `result`!
-        auto checkFile = [&](upath path) {
-            return path.fileExists() ? (res = path, true) : false;
+        auto checkFile = [&](const mstring& folder, const mstring& name) {
+            return present(folder, name) ? (res = folder + name, true) : false;
         };
-        auto checkFilesAtBasePath = [&](mstring basePath, unsigned size,
+        auto checkFilesInFolder = [&](const mstring& dirPath, unsigned size,
                 bool addSizeSfx) {
             // XXX: optimize string concatenation? Or go back to plain printf?
+            mstring base(baseName);
             if (addSizeSfx) {
-                basePath += "_";
-                basePath += mstring(long(size)) + "x" + mstring(long(size));
+                base += "_";
+                base += mstring(long(size)) + "x" + mstring(long(size));
             }
             for (auto& imgExt : iconExts) {
-                if (checkFile(basePath + imgExt))
+                if (checkFile(dirPath, base + imgExt))
                     return true;
             }
             return false;
         };
-        auto checkFilesInFolder = [&](const mstring& dirPath, unsigned size,
-                bool addSizeSfx) {
-            return checkFilesAtBasePath(dirPath + baseName, size, addSizeSfx);
-        };
         auto smartScanFolder = [&](const mstring& folder, bool addSizeSfx,
                 unsigned probeAllButThis = 0) {
 
             // full file name with suffix -> no further size/type extensions
             if (hasSuffix)
-                return checkFile(folder + baseName);
+                return checkFile(folder, baseName);
 
             if (probeAllButThis) {
                 iterUniqueSizeRev([&](unsigned is) {
@@ -424,47 +509,107 @@ upath YIcon::findIcon(unsigned size) {
     return ret;
 }
 
+upath YIcon::iconFile(unsigned size) {
+    if (fPath == null)
+        return null;
+    if (fPath.isAbsolute() && fPath.fileExists())
+        return fPath;
+    return findIcon(size);
+}
+
 ref<YImage> YIcon::loadIcon(unsigned size) {
     ref<YImage> icon;
 
     if (fPath != null) {
-        upath loadPath;
-
-        if (fPath.isAbsolute() && fPath.fileExists()) {
-            loadPath = fPath;
-        } else {
-            loadPath = findIcon(size);
-        }
-        if (loadPath != null) {
-            auto cs(loadPath.path());
-            YTraceIcon trace(cs);
-            icon = YImage::load(cs);
+        upath loadPath(iconFile(size));
+        struct stat st;
+        if (loadPath != null && loadPath.stat(&st) == 0) {
+            // a scaled copy from an earlier decoding
+            icon = YIconImageCache::load(loadPath, st, size);
+            if (icon == null) {
+                auto cs(loadPath.path());
+                YTraceIcon trace(cs);
+                icon = YImage::load(cs, size, size);
+
+                // if the image data which was found in the expected file
+                // does not really match the filename, scale the data to fit
+                if (icon != null) {
+                    if (size != icon->width() || size != icon->height()) {
+                        icon = icon->scale(size, size);
+                    }
+                    YIconImageCache::save(loadPath, st, size, icon);
+                }
+            }
         }
         else {
             TLOG(("Icon not found: %s", fPath.string()));
         }
-
-    }
-    // if the image data which was found in the expected file does not really
-    // match the filename, scale the data to fit
-    if (icon != null) {
-        if (size != icon->width() || size != icon->height()) {
-            icon = icon->scale(size, size);
-        }
     }
 
     return icon;
 }
 
 
+// Icons by name, the most recently requested first. Unreferenced
+// icons are evicted when the images of all icons exceed iconCacheSize.
+struct YIconEntry {
+    std::string name;
+    ref<YIcon> icon;
+};
+typedef std::list<YIconEntry> YIconList;
+static YIconList iconList;
+static std::unordered_map<std::string, YIconList::iterator> iconCache;
+static unsigned long iconBytes;
+// Each entry costs at least this much, also without any image,
+// so that icons which failed to load are evicted as well.
+static const unsigned long entryBytes = 256UL;
+
+static unsigned long imageBytes(ref<YImage> image) {
+    return image != null ? 4UL * image->width() * image->height() : 0UL;
+}
+
+unsigned long YIcon::pixelBytes() const {
+    return imageBytes(fSmall) + imageBytes(fLarge) + imageBytes(fHuge);
+}
+
 ref<YImage> YIcon::bestLoad(int size, ref<YImage>& img, bool& flag) {
     if (flag == false) {
         img = loadIcon(size);
         flag = true;
+        if (fCached)
+            iconBytes += imageBytes(img);
     }
     return img;
 }
 
+bool YIcon::loaded(unsigned size) const {
+    if (size == smallSize())
+        return loadedS;
+    if (size == largeSize())
+        return loadedL;
+    if (size == hugeSize())
+        return loadedH;
+    return true;
+}
+
+// The result of a background load.
+void YIcon::setImage(unsigned size, ref<YImage> image) {
+    auto store = [&] (ref<YImage>& img, bool& flag) {
+        if (flag == false) {
+            img = image;
+            flag = true;
+            if (fCached)
+                iconBytes += imageBytes(img);
+        }
+    };
+    if (size == smallSize())
+        store(fSmall, loadedS);
+    else if (size == largeSize())
+        store(fLarge, loadedL);
+    else if (size == hugeSize())
+        store(fHuge, loadedH);
+}
+
 ref<YImage> YIcon::getScaledIcon(unsigned size) {
     if (size == smallSize() && (loadedS ? fSmall != null : small() != null))
         return fSmall;
@@ -500,49 +645,45 @@ ref<YImage> YIcon::getScaledIcon(unsigned size) {
     return null;
 }
 
-static YRefArray<YIcon> iconCache;
-
-void YIcon::removeFromCache() {
-    int n = iconCache.find(this);
-    if (n >= 0) {
-        iconCache.remove(n);
-    }
-}
-
-int YIcon::cacheFind(upath name) {
-    int l, r, m;
-
-    l = 0;
-    r = iconCache.getCount();
-    while (l < r) {
-        m = (l + r) / 2;
-        ref<YIcon> found = iconCache.getItem(m);
-        int cmp = name.path().compareTo(found->iconName().path());
-        if (cmp == 0) {
-            return m;
-        } else if (cmp < 0)
-            r = m;
-        else
-            l = m + 1;
+void YIcon::evictIcons() {
+    const unsigned long budget = 1024UL * max(0, iconCacheSize);
+    auto it = iconList.end();
+    while (iconBytes > budget && it != iconList.begin()) {
+        --it;
+        YIcon* icon = it->icon._ptr();
+        unsigned long bytes = icon->pixelBytes() + entryBytes;
+        if (icon->__refcount == 1) {
+            iconBytes -= min(bytes, iconBytes);
+            iconCache.erase(it->name);
+            it = iconList.erase(it);
+        }
     }
-    return -(l + 1);
 }
 
 ref<YIcon> YIcon::getIcon(const char *name) {
-    int n = cacheFind(name);
-    if (n >= 0)
-        return iconCache.getItem(n);
+    std::string key(Elvis(name, ""));
+    auto found = iconCache.find(key);
+    if (found != iconCache.end()) {
+        iconList.splice(iconList.begin(), iconList, found->second);
+        return found->second->icon;
+    }
 
+    evictIcons();
     ref<YIcon> newicon(new YIcon(name));
-    if (newicon != null) {
-        newicon->setCached(true);
-        iconCache.insert(-n - 1, newicon);
-    }
+    newicon->setCached(true);
+    iconBytes += entryBytes;
+    iconList.push_front(YIconEntry { key, newicon });
+    iconCache.emplace(key, iconList.begin());
     return newicon;
 }
 
 void YIcon::freeIcons() {
+    YIconLoader::shutdown();
+    for (auto& entry : iconList)
+        entry.icon->setCached(false);
     iconCache.clear();
+    iconList.clear();
+    iconBytes = 0;
 }
 
 unsigned YIcon::menuSize() {
@@ -561,7 +702,17 @@ unsigned YIcon::hugeSize() {
     return hugeIconSize;
 }
 
-bool YIcon::draw(Graphics& g, int x, int y, int size) {
+bool YIcon::draw(Graphics& g, int x, int y, int size, YWindow* owner) {
+    if (owner && loaded(size) == false &&
+        YIconLoader::request(this, size, owner))
+    {
+        // the default icon holds the place until the owner is repainted
+        ref<YIcon> holder(getIcon("app"));
+        if (holder != null && holder._ptr() != this)
+            holder->draw(g, x, y, size);
+        return true;
+    }
+
     ref<YImage> image = getScaledIcon(size);
     if (image != null) {
         if (!doubleBuffer) {
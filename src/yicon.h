@@ -1,6 +1,8 @@
 #ifndef YICON_H
 #define YICON_H
 
+class YWindow;
+
 class YIcon: public refcounted {
 public:
     YIcon(upath fileName);
@@ -26,7 +28,9 @@ public:
     static unsigned largeSize();
     static unsigned hugeSize();
 
-    bool draw(Graphics &g, int x, int y, int size);
+    // With an owner, a missing image may be decoded in the background.
+    // The default icon is drawn until the owner is repainted when it is ready.
+    bool draw(Graphics &g, int x, int y, int size, YWindow* owner = nullptr);
     upath findIcon(unsigned size);
 
 #ifdef SUPPORT_XDG_ICON_TYPE_CATEGORIES
@@ -58,9 +62,14 @@ private:
 
     ref<YImage> bestLoad(int size, ref<YImage>& img, bool& flag);
 
-    void removeFromCache();
-    static int cacheFind(upath name);
+    unsigned long pixelBytes() const;
+    static void evictIcons();
     ref<YImage> loadIcon(unsigned size);
+    upath iconFile(unsigned size);
+    bool loaded(unsigned size) const;
+    void setImage(unsigned size, ref<YImage> image);
+
+    friend class YIconLoader;
 };
 
 #endif
@@ -0,0 +1,443 @@
+/*
+ * IceWM
+ *
+ * A persistent index of the icon files in the icon folders.
+ *
+ * The file consists of a header, one record per folder, the sorted
+ * base names of icon files, their entries of folder and extension,
+ * and finally all strings, each terminated by a zero byte.
+ */
+#include "config.h"
+#include "yiconcache.h"
+#include "yimage.h"
+#include "ypointer.h"
+#include "yapp.h"
+#include "udir.h"
+#include "debug.h"
+#include "base.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+
+static const char cacheMagic[8] = { 'I', 'c', 'e', 'I', 'c', 'o', 'n', '1' };
+
+static const char cacheExts[][5] = { ".png", ".xpm", ".svg" };
+
+struct YIconCache::Header {
+    char magic[8];
+    int64_t written;
+    uint32_t folders;
+    uint32_t names;
+    uint32_t entries;
+    uint32_t strings;       // bytes
+};
+
+struct YIconCache::Record {
+    int64_t modified;
+    uint32_t path;
+    uint32_t size;
+};
+
+struct YIconCache::Name {
+    uint32_t name;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct YIconCache::Entry {
+    uint32_t folder;
+    uint32_t extension;
+};
+
+// The index into cacheExts of the extension of name, or -1.
+static int extension(const char* name, const char** dot) {
+    *dot = strrchr(name, '.');
+    if (*dot) {
+        for (int i = 0; i < int ACOUNT(cacheExts); ++i)
+            if (0 == strcmp(*dot, cacheExts[i]))
+                return i;
+    }
+    return -1;
+}
+
+YIconCache::YIconCache() :
+    fData(nullptr),
+    fSize(0)
+{
+}
+
+YIconCache::~YIconCache() {
+    unmap();
+}
+
+void YIconCache::unmap() {
+    fMap.unmap();
+    fData = nullptr;
+    fSize = 0;
+    std::vector<char>().swap(fBuffer);
+}
+
+const YIconCache::Header* YIconCache::header() const {
+    return reinterpret_cast<const Header *>(fData);
+}
+
+const YIconCache::Record* YIconCache::records() const {
+    return reinterpret_cast<const Record *>(fData + sizeof(Header));
+}
+
+const YIconCache::Name* YIconCache::names() const {
+    return reinterpret_cast<const Name *>(records() + header()->folders);
+}
+
+const YIconCache::Entry* YIconCache::entries() const {
+    return reinterpret_cast<const Entry *>(names() + header()->names);
+}
+
+const char* YIconCache::string(unsigned offset) const {
+    const char* strings = reinterpret_cast<const char *>(
+                          entries() + header()->entries);
+    return offset < header()->strings ? strings + offset : "";
+}
+
+time_t YIconCache::written() const {
+    return valid() ? time_t(header()->written) : 0;
+}
+
+time_t YIconCache::modified(unsigned folder) const {
+    return valid() && folder < header()->folders
+        ? time_t(records()[folder].modified) : 0;
+}
+
+bool YIconCache::contains(unsigned folder, const char* name) const {
+    const char* dot;
+    int ext = extension(name, &dot);
+    if (ext < 0 || valid() == false)
+        return false;
+
+    const size_t len = size_t(dot - name);
+    const Name* list = names();
+    unsigned lo = 0, hi = header()->names;
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        const char* s = string(list[mid].name);
+        int c = strncmp(s, name, len);
+        if (c == 0 && s[len])
+            c = 1;
+        if (c < 0)
+            lo = mid + 1;
+        else if (c > 0)
+            hi = mid;
+        else {
+            const unsigned first = list[mid].first;
+            const unsigned stop = min(first + list[mid].count,
+                                      unsigned(header()->entries));
+            const Entry* entry = entries();
+            for (unsigned i = first; i < stop; ++i)
+                if (entry[i].folder == folder &&
+                    entry[i].extension == unsigned(ext))
+                    return true;
+            return false;
+        }
+    }
+    return false;
+}
+
+bool YIconCache::verify(const std::vector<Folder>& folders) const {
+    const Header* head = header();
+    if (head->folders != folders.size())
+        return false;
+
+    const size_t size = sizeof(Header)
+                      + head->folders * sizeof(Record)
+                      + head->names * sizeof(Name)
+                      + head->entries * sizeof(Entry)
+                      + head->strings;
+    if (size != fSize || head->strings == 0 || fData[fSize - 1])
+        return false;
+
+    for (unsigned i = 0; i < head->folders; ++i) {
+        const Record& rec = records()[i];
+        mstring path(folders[i].path);
+        struct stat st;
+        if (rec.size != folders[i].size ||
+            strcmp(string(rec.path), path.c_str()) ||
+            upath(path).stat(&st) ||
+            st.st_mtime != time_t(rec.modified) ||
+            rec.modified >= head->written)
+            return false;
+    }
+    return true;
+}
+
+bool YIconCache::build(const std::vector<Folder>& folders) {
+    std::map<std::string, std::vector<Entry>> index;
+    std::vector<Record> recs(folders.size());
+    std::string strings;
+    time_t now = time(nullptr);
+
+    for (unsigned i = 0; i < folders.size(); ++i) {
+        mstring path(folders[i].path);
+        struct stat st;
+        recs[i].modified = upath(path).stat(&st) ? -1 : int64_t(st.st_mtime);
+        recs[i].path = unsigned(strings.size());
+        recs[i].size = folders[i].size;
+        strings.append(path.c_str(), path.length() + 1);
+
+        for (cdir dir(path.c_str()); dir.next(); ) {
+            const char* dot;
+            int ext = extension(dir.entry(), &dot);
+            if (ext >= 0) {
+                std::string base(dir.entry(), dot - dir.entry());
+                index[base].push_back(Entry { i, unsigned(ext) });
+            }
+        }
+    }
+
+    unsigned count = 0;
+    for (const auto& it : index)
+        count += unsigned(it.second.size());
+
+    const size_t size = sizeof(Header)
+                      + recs.size() * sizeof(Record)
+                      + index.size() * sizeof(Name)
+                      + count * sizeof(Entry);
+    size_t names = 0;
+    for (const auto& it : index)
+        names += it.first.size() + 1;
+    fBuffer.assign(size + strings.size() + names, '\0');
+
+    char* data = fBuffer.data();
+    Header* head = reinterpret_cast<Header *>(data);
+    memcpy(head->magic, cacheMagic, sizeof cacheMagic);
+    head->written = now;
+    head->folders = unsigned(recs.size());
+    head->names = unsigned(index.size());
+    head->entries = count;
+    head->strings = unsigned(strings.size() + names);
+
+    memcpy(data + sizeof(Header), recs.data(), recs.size() * sizeof(Record));
+    Name* name = reinterpret_cast<Name *>(data + sizeof(Header)
+                                          + recs.size() * sizeof(Record));
+    Entry* entry = reinterpret_cast<Entry *>(name + index.size());
+    char* string = reinterpret_cast<char *>(entry + count);
+    memcpy(string, strings.data(), strings.size());
+
+    unsigned offset = unsigned(strings.size()), first = 0;
+    for (const auto& it : index) {
+        name->name = offset;
+        name->first = first;
+        name->count = unsigned(it.second.size());
+        memcpy(string + offset, it.first.c_str(), it.first.size() + 1);
+        offset += unsigned(it.first.size() + 1);
+        for (const Entry& e : it.second)
+            entry[first++] = e;
+        ++name;
+    }
+
+    fData = data;
+    fSize = fBuffer.size();
+    MSG(("indexed %u icon names in %u folders", head->names, head->folders));
+    return true;
+}
+
+bool YIconCache::save(const char* path) const {
+    return replaceFile(path, fData, fSize);
+}
+
+void YIconCache::load(const std::vector<Folder>& folders) {
+    unmap();
+
+    upath path(YApplication::getCacheDir() + "/icons.cache");
+    if (fMap.map(path, cacheMagic, sizeof(Header))) {
+        fData = fMap.data();
+        fSize = fMap.size();
+    }
+    if (fData && verify(folders)) {
+        MSG(("using icon cache %s", path.string()));
+        return;
+    }
+
+    unmap();
+    if (build(folders) && save(path.string()) == false) {
+        MSG(("could not write icon cache %s", path.string()));
+    }
+}
+
+static const char imageMagic[8] = { 'I', 'c', 'e', 'A', 'R', 'G', 'B', '1' };
+
+struct YIconImageCache::Header {
+    char magic[8];
+    int64_t modified;       // of the source
+    int64_t length;         // of the source
+    int64_t inode;          // of the source
+    uint32_t width;
+    uint32_t height;
+    uint32_t path;          // bytes of the source path, with padding
+    uint32_t reserved;
+};
+
+// The source path with a terminating zero, padded to four bytes.
+static size_t padded(const mstring& name) {
+    return (name.length() + 4) & ~size_t(3);
+}
+
+upath YIconImageCache::location(upath source, unsigned size) {
+    uint64_t hash = fnvHash(fnvOffset, source.string());
+    char name[40];
+    snprintf(name, sizeof name, "/%016llx-%u.argb",
+             (unsigned long long) hash, size);
+    return upath(mstring(directory()) + name);
+}
+
+static std::string iconsFolder() {
+    upath path(YApplication::getCacheDir() + "/icons");
+    return path.string();
+}
+
+const char* YIconImageCache::directory() {
+    // A private copy which worker threads can use without sharing
+    // the reference count of the application cache path.
+    static const std::string dir(iconsFolder());
+    return dir.c_str();
+}
+
+// A cache file which is mapped and matches its source.
+class YIconImageCache::Mapping {
+public:
+    Mapping(upath source, const struct stat& st, unsigned size);
+    // The size x size ARGB pixels, or null.
+    const uint32_t* pixels() const { return fPixels; }
+
+private:
+    YCacheMap fMap;
+    const uint32_t* fPixels;
+};
+
+YIconImageCache::Mapping::Mapping(upath source, const struct stat& st,
+                                  unsigned size) :
+    fPixels(nullptr)
+{
+    mstring name(source.path());
+    const size_t pad = padded(name);
+    const size_t count = size_t(size) * size;
+    const size_t total = sizeof(Header) + pad + count * sizeof(uint32_t);
+    if (fMap.map(location(source, size), imageMagic, total) &&
+        fMap.size() == total)
+    {
+        const Header* head = reinterpret_cast<const Header *>(fMap.data());
+        const char* text = reinterpret_cast<const char *>(head + 1);
+        if (head->modified == int64_t(st.st_mtime) &&
+            head->length == int64_t(st.st_size) &&
+            head->inode == int64_t(st.st_ino) &&
+            head->width == size && head->height == size &&
+            head->path == pad &&
+            0 == strncmp(text, name.c_str(), pad))
+        {
+            fPixels = reinterpret_cast<const uint32_t *>(text + pad);
+        }
+    }
+}
+
+ref<YImage> YIconImageCache::load(upath source, const struct stat& st,
+                                  unsigned size)
+{
+    ref<YImage> image;
+    Mapping mapping(source, st, size);
+    if (mapping.pixels())
+        image = YImage::createFromPixels(mapping.pixels(), size, size);
+    return image;
+}
+
+bool YIconImageCache::loadPixels(upath source, const struct stat& st,
+                                 unsigned size, uint32_t* argb)
+{
+    Mapping mapping(source, st, size);
+    if (mapping.pixels() == nullptr)
+        return false;
+    memcpy(argb, mapping.pixels(), size_t(size) * size * sizeof(uint32_t));
+    return true;
+}
+
+// Remove files which were written long ago, and the oldest files
+// when there are more than a theme change or two would write.
+void YIconImageCache::prune() {
+    const time_t maxAge = 90 * 24 * 60 * 60;
+    const size_t maxFiles = 4096;
+    const time_t now = time(nullptr);
+    const std::string dir(directory());
+
+    std::vector<std::pair<time_t, std::string>> files;
+    for (cdir list(dir.c_str()); list.next(); ) {
+        const char* entry = list.entry();
+        if (*entry == '.')
+            continue;
+        std::string path(dir + "/" + entry);
+        struct stat st;
+        if (lstat(path.c_str(), &st) || !S_ISREG(st.st_mode))
+            continue;
+        if (st.st_mtime + maxAge < now)
+            unlink(path.c_str());
+        else if (path.size() > 5 &&
+                 path.compare(path.size() - 5, 5, ".argb") == 0)
+            files.emplace_back(st.st_mtime, path);
+    }
+
+    if (files.size() > maxFiles) {
+        std::sort(files.begin(), files.end());
+        const size_t remove = files.size() - maxFiles * 3 / 4;
+        for (size_t i = 0; i < remove; ++i)
+            unlink(files[i].second.c_str());
+        MSG(("removed %zu icon images", remove));
+    }
+}
+
+void YIconImageCache::save(upath source, const struct stat& st,
+                           unsigned size, ref<YImage> image)
+{
+    if (image == null || image->width() != size || image->height() != size)
+        return;
+
+    std::vector<uint32_t> argb(size_t(size) * size);
+    if (image->readPixels(argb.data()))
+        save(source, st, size, argb.data());
+}
+
+void YIconImageCache::save(upath source, const struct stat& st,
+                           unsigned size, const uint32_t* argb)
+{
+    mstring name(source.path());
+    const size_t pad = padded(name);
+    const size_t count = size_t(size) * size;
+    std::vector<char> data(sizeof(Header) + pad + count * sizeof(uint32_t));
+    Header* head = reinterpret_cast<Header *>(data.data());
+    char* text = reinterpret_cast<char *>(head + 1);
+    memcpy(text + pad, argb, count * sizeof(uint32_t));
+
+    memcpy(head->magic, imageMagic, sizeof imageMagic);
+    head->modified = int64_t(st.st_mtime);
+    head->length = int64_t(st.st_size);
+    head->inode = int64_t(st.st_ino);
+    head->width = size;
+    head->height = size;
+    head->path = unsigned(pad);
+    memcpy(text, name.c_str(), name.length());
+
+    upath dir(directory());
+    if (dir.dirExists() == false)
+        dir.mkdir();
+    static std::once_flag pruned;
+    std::call_once(pruned, prune);
+    upath path(location(source, size));
+    if (replaceFile(path, data.data(), data.size()) == false) {
+        MSG(("could not write icon image %s", path.string()));
+    }
+}
+
+// vim: set sw=4 ts=4 et:
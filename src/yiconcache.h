@@ -0,0 +1,102 @@
+#ifndef YICONCACHE_H
+#define YICONCACHE_H
+
+#include "mstring.h"
+#include "upath.h"
+#include "ref.h"
+#include "ycachefile.h"
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <vector>
+
+/*
+ * A file in the user cache directory which lists the icon files
+ * of a fixed sequence of icon folders. It maps an icon base name
+ * to the folders and image extensions where it is present.
+ * The cache is valid if the folders and their modification times
+ * are the same as when it was written, otherwise it is rebuilt.
+ */
+class YIconCache {
+public:
+    struct Folder {
+        mstring path;       // ends in a slash
+        unsigned size;      // icon size of the folder, or zero
+    };
+
+    YIconCache();
+    ~YIconCache();
+
+    // Map the cache file, or read the folders and write a new one.
+    void load(const std::vector<Folder>& folders);
+
+    bool valid() const { return fData != nullptr; }
+    // When the folders were read.
+    time_t written() const;
+    // The modification time of a folder when it was read.
+    time_t modified(unsigned folder) const;
+    // Whether a folder has a file with this name and an image extension.
+    bool contains(unsigned folder, const char* name) const;
+
+private:
+    struct Header;
+    struct Record;
+    struct Name;
+    struct Entry;
+
+    bool verify(const std::vector<Folder>& folders) const;
+    bool build(const std::vector<Folder>& folders);
+    bool save(const char* path) const;
+    void unmap();
+
+    const Header* header() const;
+    const Record* records() const;
+    const Name* names() const;
+    const Entry* entries() const;
+    const char* string(unsigned offset) const;
+
+    const char* fData;
+    size_t fSize;
+    YCacheMap fMap;
+    std::vector<char> fBuffer;
+
+    YIconCache(const YIconCache&);
+    YIconCache& operator=(const YIconCache&);
+};
+
+class YImage;
+
+/*
+ * Icon images after scaling to one size, kept as files of ARGB
+ * pixels which can be mapped and turned into images directly.
+ * A file is keyed by the path of the source image and the size,
+ * and it is valid for the modification time and file size of the
+ * source at the time it was written. Old files are removed when
+ * they exceed an age or when there are too many of them.
+ */
+class YIconImageCache {
+public:
+    // The status st of the source must be taken before it is decoded.
+    static ref<YImage> load(upath source, const struct stat& st,
+                            unsigned size);
+    static void save(upath source, const struct stat& st,
+                     unsigned size, ref<YImage> image);
+    // Store size x size ARGB pixels, also on a worker thread.
+    static void save(upath source, const struct stat& st,
+                     unsigned size, const uint32_t* argb);
+    // Read size x size pixels into argb, without creating an image.
+    static bool loadPixels(upath source, const struct stat& st,
+                           unsigned size, uint32_t* argb);
+    // The cache folder. The first call must be on the main thread.
+    static const char* directory();
+
+private:
+    struct Header;
+    class Mapping;
+    static upath location(upath source, unsigned size);
+    static void prune();
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
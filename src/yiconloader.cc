@@ -0,0 +1,200 @@
+/*
+ * IceWM
+ *
+ * Background decoding of icon images.
+ */
+#include "config.h"
+#include "yiconloader.h"
+#include "yiconcache.h"
+#include "yimage.h"
+#include "yicon.h"
+#include "yscale.h"
+#include "yprefs.h"
+#include "yxapp.h"
+#include "ywindow.h"
+#include "debug.h"
+#include "base.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+static YIconLoader* iconLoader;
+
+YIconLoader::YIconLoader(unsigned threads) :
+    YPollBase(),
+    fSignal(-1),
+    fStopping(false)
+{
+    int fds[2];
+    if (pipe(fds) == -1) {
+        fail("pipe");
+        return;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fSignal = fds[1];
+    registerPoll(fds[0]);
+
+    // lazy statics which the workers use are set up here first
+    YScaler::kernel();
+    YIconImageCache::directory();
+
+    for (unsigned i = 0; i < threads; ++i)
+        fThreads.emplace_back(&YIconLoader::work, this);
+}
+
+YIconLoader::~YIconLoader() {
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fStopping = true;
+    }
+    fWakeup.notify_all();
+    for (auto& thread : fThreads)
+        thread.join();
+
+    for (Job* job : fPending)
+        delete job;
+    closePoll();
+    if (fSignal >= 0)
+        close(fSignal);
+}
+
+bool YIconLoader::request(YIcon* icon, unsigned size, YWindow* owner) {
+    if (iconLoadThreads <= 0 || mainLoop == nullptr)
+        return false;
+    if (iconLoader == nullptr) {
+        iconLoader = new YIconLoader(unsigned(min(iconLoadThreads, 16)));
+        if (iconLoader->fSignal < 0) {
+            delete iconLoader;
+            iconLoader = nullptr;
+            return false;
+        }
+    }
+    return iconLoader->queue(icon, size, owner);
+}
+
+void YIconLoader::forget(YWindow* owner) {
+    if (iconLoader) {
+        for (Job* job : iconLoader->fPending) {
+            auto& owners = job->owners;
+            owners.erase(std::remove(owners.begin(), owners.end(), owner),
+                         owners.end());
+        }
+    }
+}
+
+void YIconLoader::shutdown() {
+    if (iconLoader) {
+        delete iconLoader;
+        iconLoader = nullptr;
+    }
+}
+
+bool YIconLoader::queue(YIcon* icon, unsigned size, YWindow* owner) {
+    for (Job* job : fPending) {
+        if (job->icon._ptr() == icon && job->size == size) {
+            if (std::find(job->owners.begin(), job->owners.end(), owner)
+                == job->owners.end())
+            {
+                job->owners.push_back(owner);
+                owner->waitForIcon();
+            }
+            return true;
+        }
+    }
+
+    upath path(icon->iconFile(size));
+    if (path == null || YImage::loadsConcurrently(path) == false)
+        return false;
+
+    Job* job = new Job;
+    job->icon.init(icon);
+    job->size = size;
+    job->path = path.string();
+    job->decoded = false;
+    job->owners.push_back(owner);
+    owner->waitForIcon();
+    fPending.push_back(job);
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fQueue.push_back(job);
+    }
+    fWakeup.notify_one();
+    return true;
+}
+
+void YIconLoader::work() {
+    std::unique_lock<std::mutex> lock(fMutex);
+    while (fStopping == false) {
+        if (fQueue.empty()) {
+            fWakeup.wait(lock);
+            continue;
+        }
+        Job* job = fQueue.front();
+        fQueue.pop_front();
+
+        lock.unlock();
+        job->decoded = decode(job);
+        lock.lock();
+
+        fDone.push_back(job);
+        char byte = 0;
+        if (write(fSignal, &byte, 1) == -1 && errno != EAGAIN) {
+            TLOG(("icon loader write: %s", strerror(errno)));
+        }
+    }
+}
+
+// On a worker thread: only the path and the pixels of the job are used.
+bool YIconLoader::decode(Job* job) {
+    upath path(job->path.c_str());
+    const unsigned size = job->size;
+    struct stat st;
+    if (path.stat(&st) != 0)
+        return false;
+
+    job->pixels.resize(size_t(size) * size);
+    uint32_t* argb = job->pixels.data();
+    if (YIconImageCache::loadPixels(path, st, size, argb))
+        return true;
+    if (YImage::loadPixels(path, size, size, argb) == false)
+        return false;
+
+    YIconImageCache::save(path, st, size, argb);
+    return true;
+}
+
+void YIconLoader::notifyRead() {
+    char buf[64];
+    while (read(fd(), buf, sizeof buf) > 0) { }
+
+    std::deque<Job*> done;
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        done.swap(fDone);
+    }
+    for (Job* job : done)
+        complete(job);
+}
+
+void YIconLoader::complete(Job* job) {
+    fPending.erase(std::find(fPending.begin(), fPending.end(), job));
+
+    ref<YImage> image;
+    if (job->decoded)
+        image = YImage::createFromPixels(job->pixels.data(),
+                                         job->size, job->size);
+    job->icon->setImage(job->size, image);
+
+    for (YWindow* owner : job->owners)
+        owner->invalidate();
+    delete job;
+}
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,68 @@
+#ifndef YICONLOADER_H
+#define YICONLOADER_H
+
+#include "ypoll.h"
+#include "ref.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class YIcon;
+class YWindow;
+
+/*
+ * Decodes and scales icon images on a few worker threads into ARGB
+ * buffers, without any Xlib calls. A pipe wakes the main loop when
+ * jobs are done, which then turns the pixels into images for the icons
+ * and repaints the windows which drew a placeholder in the meantime.
+ */
+class YIconLoader: public YPollBase {
+public:
+    // Queue the image of this size for icon, to repaint owner when done.
+    // False if the image must be loaded synchronously.
+    static bool request(YIcon* icon, unsigned size, YWindow* owner);
+    // Remove a window which is destroyed from the pending jobs.
+    static void forget(YWindow* owner);
+    // Stop the threads and forget the pending jobs.
+    static void shutdown();
+
+private:
+    struct Job {
+        ref<YIcon> icon;            // only touched by the main thread
+        unsigned size;
+        std::string path;
+        std::vector<uint32_t> pixels;
+        bool decoded;
+        std::vector<YWindow*> owners;
+    };
+
+    explicit YIconLoader(unsigned threads);
+    ~YIconLoader();
+
+    bool queue(YIcon* icon, unsigned size, YWindow* owner);
+    void work();
+    void complete(Job* job);
+    static bool decode(Job* job);
+
+    virtual void notifyRead();
+    virtual bool forRead() { return true; }
+
+    std::vector<std::thread> fThreads;
+    std::mutex fMutex;
+    std::condition_variable fWakeup;
+    std::deque<Job*> fQueue;        // waiting for a thread
+    std::deque<Job*> fDone;         // waiting for the main loop
+    std::vector<Job*> fPending;     // all jobs, main thread only
+    int fSignal;                    // write end of the pipe
+    bool fStopping;
+
+    YIconLoader(const YIconLoader&);
+    YIconLoader& operator=(const YIconLoader&);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
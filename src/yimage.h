@@ -3,13 +3,17 @@
 
 #include "ref.h"
 #include "ypaint.h"
+#include <stdint.h>
 
 class YPixmap;
 class Graphics;
 
 class YImage: public refcounted {
 public:
-    static ref<YImage> load(upath filename);
+    // A nonzero width and height permit a loader to return a reduced
+    // image which is still at least as large as width x height.
+    static ref<YImage> load(upath filename,
+                            unsigned width = 0, unsigned height = 0);
     static ref<YImage> createFromPixmap(ref<YPixmap> image);
     static ref<YImage> createFromPixmapAndMask(Pixmap pix, Pixmap mask,
                                                unsigned width, unsigned height);
@@ -18,7 +22,16 @@ public:
                                                      unsigned nw, unsigned nh);
     static ref<YImage> createFromIconProperty(long *pixels,
                                               unsigned width, unsigned height);
+    // From width x height ARGB pixels without premultiplication.
+    static ref<YImage> createFromPixels(const uint32_t* argb,
+                                        unsigned width, unsigned height);
     static bool supportsDepth(unsigned depth);
+    // Whether loadPixels may decode this file on a thread other than main.
+    static bool loadsConcurrently(upath filename);
+    // Decode and scale to width x height ARGB pixels, without requests
+    // to the X server. Only for files where loadsConcurrently holds.
+    static bool loadPixels(upath filename, unsigned width, unsigned height,
+                           uint32_t* argb);
     static const char* renderName();
 
     unsigned width() const { return fWidth; }
@@ -34,6 +47,8 @@ public:
     virtual void composite(Graphics &g, int x, int y, unsigned w, unsigned h, int dx, int dy) = 0;
     virtual ref<YImage> subimage(int x, int y, unsigned w, unsigned h) = 0;
     virtual void save(upath filename) = 0;
+    // Store width x height pixels as ARGB without premultiplication.
+    virtual bool readPixels(uint32_t* argb) const = 0;
     virtual void copy(Graphics& g, int x, int y) { draw(g, x, y); }
 
 protected:
@@ -5,6 +5,7 @@
 #include "yimage.h"
 #include "yxapp.h"
 #include <Imlib2.h>
+#include <string.h>
 
 #ifdef CONFIG_LIBRSVG
 #include <librsvg/rsvg.h>
@@ -35,6 +36,7 @@ public:
     virtual bool valid() const { return fImage != nullptr; }
     virtual ref<YImage> subimage(int x, int y, unsigned w, unsigned h);
     virtual void save(upath filename);
+    virtual bool readPixels(uint32_t* argb) const;
     virtual void copy(Graphics& g, int x, int y);
     static ref<YImage> loadsvg(upath filename);
 
@@ -134,7 +136,16 @@ ref<YImage> YImage2::loadsvg(upath filename) {
     return icon;
 }
 
-ref<YImage> YImage::load(upath filename) {
+bool YImage::loadsConcurrently(upath) {
+    // Imlib2 keeps its state in a global context.
+    return false;
+}
+
+bool YImage::loadPixels(upath, unsigned, unsigned, uint32_t*) {
+    return false;
+}
+
+ref<YImage> YImage::load(upath filename, unsigned, unsigned) {
     if (filename.getExtension() == ".svg") {
         return YImage2::loadsvg(filename);
     }
@@ -190,6 +201,18 @@ void YImage2::save(upath filename) {
     imlib_save_image(filename.replaceExtension(".png").string());
 }
 
+bool YImage2::readPixels(uint32_t* argb) const {
+    context();
+    DATA32* data = imlib_image_get_data_for_reading_only();
+    if (data == nullptr)
+        return false;
+    const unsigned count = width() * height();
+    const uint32_t opaque = imlib_image_has_alpha() ? 0 : 0xFF000000;
+    for (unsigned i = 0; i < count; ++i)
+        argb[i] = uint32_t(data[i]) | opaque;
+    return true;
+}
+
 ref<YImage> YImage2::scale(unsigned w, unsigned h) {
     if (w == width() && h == height())
         return ref<YImage>(this);
@@ -278,6 +301,22 @@ ref<YImage> YImage::createFromIconProperty(long* prop_pixels,
     return null;
 }
 
+ref<YImage> YImage::createFromPixels(const uint32_t* argb,
+                                     unsigned width, unsigned height)
+{
+    Image image = imlib_create_image(int(width), int(height));
+    if (image) {
+        imlib_context_set_image(image);
+        imlib_context_set_mask_alpha_threshold(ATH);
+        imlib_image_set_has_alpha(1);
+        DATA32* data = imlib_image_get_data();
+        memcpy(data, argb, size_t(width) * height * sizeof(DATA32));
+        imlib_image_put_back_data(data);
+        return ref<YImage>(new YImage2(width, height, image));
+    }
+    return null;
+}
+
 ref<YImage> YImage::createFromPixmapAndMaskScaled(Pixmap pix, Pixmap mask,
                                                   unsigned width, unsigned height,
                                                   unsigned nw, unsigned nh)
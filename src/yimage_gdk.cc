@@ -5,6 +5,7 @@
 #include "yimage.h"
 #include "yxapp.h"
 #include <stdlib.h>
+#include <math.h>
 #include <gdk-pixbuf-xlib/gdk-pixbuf-xlib.h>
 
 #define ATH 10  /* alpha threshold */
@@ -31,6 +32,7 @@ public:
     virtual bool valid() const { return fPixbuf != nullptr; }
     virtual ref<YImage> subimage(int x, int y, unsigned w, unsigned h);
     virtual void save(upath filename);
+    virtual bool readPixels(uint32_t* argb) const;
 
 private:
     GdkPixbuf *fPixbuf;
@@ -52,10 +54,36 @@ unsigned YImageGDK::depth() const {
     return 8 * gdk_pixbuf_get_n_channels(fPixbuf);
 }
 
-ref<YImage> YImage::load(upath filename) {
+bool YImage::loadsConcurrently(upath) {
+    // Pixbuf loaders are modules which are not all thread-safe.
+    return false;
+}
+
+bool YImage::loadPixels(upath, unsigned, unsigned, uint32_t*) {
+    return false;
+}
+
+ref<YImage> YImage::load(upath filename, unsigned width, unsigned height) {
     ref<YImage> image;
     GError *gerror = nullptr;
-    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(filename.string(), &gerror);
+    GdkPixbuf *pixbuf = nullptr;
+
+    // Let the loader reduce a large image to the requested size.
+    int w = 0, h = 0;
+    if ((width || height) &&
+        gdk_pixbuf_get_file_info(filename.string(), &w, &h) &&
+        unsigned(w) > width && unsigned(h) > height)
+    {
+        double f = max(double(width) / w, double(height) / h);
+        pixbuf = gdk_pixbuf_new_from_file_at_scale(filename.string(),
+                                                   int(ceil(w * f)),
+                                                   int(ceil(h * f)),
+                                                   TRUE, &gerror);
+    }
+    if (pixbuf == nullptr) {
+        g_clear_error(&gerror);
+        pixbuf = gdk_pixbuf_new_from_file(filename.string(), &gerror);
+    }
 
     if (pixbuf != nullptr) {
         image.init(new YImageGDK(gdk_pixbuf_get_width(pixbuf),
@@ -81,7 +109,7 @@ ref<YImage> YImage::load(upath filename) {
 
         filename = filename.parent().relative(match);
         if (filename.fileSize() > lim)
-            return load(filename);
+            return load(filename, width, height);
     }
     return image;
 }
@@ -96,6 +124,23 @@ void YImageGDK::save(upath filename) {
     }
 }
 
+bool YImageGDK::readPixels(uint32_t* argb) const {
+    const int channels = gdk_pixbuf_get_n_channels(fPixbuf);
+    if (gdk_pixbuf_get_bits_per_sample(fPixbuf) != 8 || channels < 3)
+        return false;
+    const guchar* pixels = gdk_pixbuf_get_pixels(fPixbuf);
+    const int stride = gdk_pixbuf_get_rowstride(fPixbuf);
+    const bool alpha = gdk_pixbuf_get_has_alpha(fPixbuf);
+    for (unsigned r = 0; r < height(); r++, pixels += stride) {
+        const guchar* p = pixels;
+        for (unsigned c = 0; c < width(); c++, p += channels) {
+            uint32_t A = alpha ? p[3] : 0xFF;
+            *argb++ = (A << 24) | (p[0] << 16) | (p[1] << 8) | p[2];
+        }
+    }
+    return true;
+}
+
 ref<YImage> YImageGDK::scale(unsigned w, unsigned h) {
     if (w == width() && h == height())
         return ref<YImage>(this);
@@ -209,6 +254,35 @@ ref<YImage> YImage::createFromIconProperty(long *prop_pixels,
     return image;
 }
 
+ref<YImage> YImage::createFromPixels(const uint32_t* argb,
+                                     unsigned width, unsigned height)
+{
+    ref<YImage> image;
+    GdkPixbuf *pixbuf =
+        gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8,
+                       width, height);
+
+    if (!pixbuf)
+        return null;
+
+    guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+
+    for (unsigned r = 0; r < height; r++) {
+        for (unsigned c = 0; c < width; c++) {
+            uint32_t pix = argb[c + r * width];
+            pixels[c * 4 + 2] = (unsigned char)(pix & 0xFF);
+            pixels[c * 4 + 1] = (unsigned char)((pix >> 8) & 0xFF);
+            pixels[c * 4] = (unsigned char)((pix >> 16) & 0xFF);
+            pixels[c * 4 + 3] = (unsigned char)((pix >> 24) & 0xFF);
+        }
+        pixels += gdk_pixbuf_get_rowstride(pixbuf);
+    }
+    image.init(new YImageGDK(width,
+                             height,
+                             pixbuf));
+    return image;
+}
+
 ref<YImage> YImage::createFromPixmapAndMaskScaled(Pixmap pix, Pixmap mask,
                                                   unsigned width, unsigned height,
                                                   unsigned nw, unsigned nh)
@@ -62,7 +62,7 @@ public:
     void unselectAll();
     bool cutSelection();
     bool copySelection();
-    void complete();
+    virtual void complete();
 
 private:
     virtual bool handleTimer(YTimer *timer);
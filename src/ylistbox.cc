@@ -61,6 +61,9 @@ YListBox::YListBox(YScrollView *view, YWindow *aParent):
     fFocusedItem(0),
     fSelectStart(-1),
     fSelectEnd(-1),
+    fSelectedLow(0),
+    fSelectedHigh(-1),
+    fNumbered(0),
     fDragging(false),
     fSelect(false),
     fVisible(false),
@@ -93,10 +96,52 @@ bool YListBox::isFocusTraversable() {
     return true;
 }
 
+// Positions of items are remembered in the items and renumbered
+// from the first change on demand, which makes findItem cheap.
+int YListBox::findItem(YListItem *item) {
+    if (item == nullptr)
+        return -1;
+    if (inrange(item->fIndex, 0, fNumbered - 1) &&
+        fItems[item->fIndex] == item)
+        return item->fIndex;
+    if (fNumbered < getItemCount()) {
+        for (int i = fNumbered; i < getItemCount(); ++i)
+            fItems[i]->fIndex = i;
+        fNumbered = getItemCount();
+        if (inrange(item->fIndex, 0, fNumbered - 1) &&
+            fItems[item->fIndex] == item)
+            return item->fIndex;
+    }
+    return -1;
+}
+
+void YListBox::inserted(int index) {
+    fNumbered = min(fNumbered, index);
+    if (fSelectedLow >= index)
+        fSelectedLow++;
+    if (fSelectedHigh >= index)
+        fSelectedHigh++;
+}
+
+void YListBox::removed(int index) {
+    fNumbered = min(fNumbered, index);
+    if (fSelectedLow > index)
+        fSelectedLow--;
+    if (fSelectedHigh >= index)
+        fSelectedHigh--;
+}
+
+int YListBox::itemWidth(YListItem *item) {
+    if (item->fWidth < 0)
+        item->fWidth = item->getWidth();
+    return item->fWidth;
+}
+
 void YListBox::addAfter(YListItem *after, YListItem *item) {
     int i = findItem(after);
     if (i >= 0) {
         fItems.insert(i + 1, item);
+        inserted(i + 1);
         if (fFocusedItem > i)
             fFocusedItem++;
         if (fWidestItem > i)
@@ -111,6 +156,7 @@ void YListBox::addBefore(YListItem *before, YListItem *item) {
     int i = findItem(before);
     if (i >= 0) {
         fItems.insert(i, item);
+        inserted(i);
         if (fFocusedItem >= i)
             fFocusedItem++;
         if (fWidestItem >= i)
@@ -130,6 +176,8 @@ void YListBox::removeItem(YListItem *item) {
     int index = findItem(item);
     if (index >= 0) {
         fItems.remove(index);
+        removed(index);
+        item->fIndex = -1;
         if (fFocusedItem > index)
             fFocusedItem--;
         else if (index == fFocusedItem) {
@@ -145,7 +193,7 @@ void YListBox::updateItems() {
         fMaxWidth = 0;
         fWidestItem = -1;
         for (IterType a(getIterator()); ++a; ) {
-            int width = a->getWidth();
+            int width = itemWidth(*a);
             if (width > fMaxWidth) {
                 fMaxWidth = width;
                 fWidestItem = a.where();
@@ -184,8 +232,7 @@ void YListBox::ensureVisibility(int item) { //!!! horiz too
         if (fy <= fOffsetY)
             oy = fy;
         if (oy != fOffsetY) {
-            fOffsetY = oy;
-            outdated();///!!!fix (use scroll)
+            scrollTo(fOffsetX, oy);
         }
     }
 }
@@ -248,6 +295,13 @@ void YListBox::repaint() {
     }
 }
 
+void YListBox::releaseBuffers() {
+    if (!fGraphics)
+        return;
+    fGraphics.release();
+    repaintOnShow();
+}
+
 bool YListBox::handleKey(const XKeyEvent &key) {
     if (key.type == KeyPress) {
         KeySym k = keyCodeToKeySym(key.keycode);
@@ -473,39 +527,36 @@ void YListBox::handleDrag(const XButtonEvent &down, const XMotionEvent &motion)
         fVerticalScroll->setValue(fVerticalScroll->getValue() - dx);
         int fy = fVerticalScroll->getValue();
         if (fy != fOffsetY) {
-            fOffsetY = fy;
-            repaint();
+            scrollTo(fOffsetX, fy);
         }
     }
 }
 
 void YListBox::scroll(YScrollBar *scroll, int delta) {
-    bool needRepaint = false;
-
-    if (scroll == fVerticalScroll) {
-        fOffsetY += delta;
-        needRepaint = true;
-    }
-    if (scroll == fHorizontalScroll) {
-        fOffsetX += delta;
-        needRepaint = true;
-    }
-    if (needRepaint)
-        repaint();
+    if (scroll == fVerticalScroll)
+        scrollTo(fOffsetX, fOffsetY + delta);
+    if (scroll == fHorizontalScroll)
+        scrollTo(fOffsetX + delta, fOffsetY);
 }
 
 void YListBox::move(YScrollBar *scroll, int pos) {
-    bool needRepaint = false;
-    if (scroll == fVerticalScroll) {
-        fOffsetY = pos;
-        needRepaint = true;
-    }
-    if (scroll == fHorizontalScroll) {
-        fOffsetX = pos;
-        needRepaint = true;
+    if (scroll == fVerticalScroll)
+        scrollTo(fOffsetX, pos);
+    if (scroll == fHorizontalScroll)
+        scrollTo(pos, fOffsetY);
+}
+
+// Shift what is shown and paint only the rows which come into view.
+void YListBox::scrollTo(int x, int y) {
+    int dx = x - fOffsetX;
+    int dy = y - fOffsetY;
+    fOffsetX = x;
+    fOffsetY = y;
+    if (fVisible && (dx || dy)) {
+        updateItems();
+        resetScrollBars();
+        fGraphics.scroll(dx, dy);
     }
-    if (needRepaint)
-        repaint();
 }
 
 void YListBox::paintItem(Graphics &g, int n) {
@@ -621,12 +672,13 @@ void YListBox::activateItem(YListItem *item) {
 void YListBox::repaintItem(YListItem *item) {
     int i = findItem(item);
     if (i != -1) {
+        item->fWidth = -1;
         if (i == fWidestItem) {
-            if (item->getWidth() != fMaxWidth) {
+            if (itemWidth(item) != fMaxWidth) {
                 outdated();
             }
         }
-        else if (item->getWidth() > fMaxWidth) {
+        else if (itemWidth(item) > fMaxWidth) {
             outdated();
         }
         paintItem(i);
@@ -677,14 +729,30 @@ void YListBox::selectItem(int item, bool select) {
     YListItem *i = getItem(item);
     if (i && i->getSelected() != select) {
         i->setSelected(select);
+        if (select)
+            markSelected(item, item);
         //msg("%d=%d", item, select);
         paintItem(item);
     }
 }
 
+void YListBox::markSelected(int beg, int end) {
+    if (fSelectedLow > fSelectedHigh) {
+        fSelectedLow = beg;
+        fSelectedHigh = end;
+    } else {
+        fSelectedLow = min(fSelectedLow, beg);
+        fSelectedHigh = max(fSelectedHigh, end);
+    }
+}
+
+// Only the range which can hold selected items is visited.
 void YListBox::clearSelection() {
-    for (int i = 0; i < getItemCount(); i++)
+    int high = min(fSelectedHigh, getItemCount() - 1);
+    for (int i = max(fSelectedLow, 0); i <= high; i++)
         selectItem(i, false);
+    fSelectedLow = 0;
+    fSelectedHigh = -1;
     fSelectStart = fSelectEnd = -1;
 }
 
@@ -701,6 +769,8 @@ void YListBox::applySelection() {
             if (i)
                 i->setSelected(fSelect);
         }
+        if (fSelect)
+            markSelected(beg, end);
     }
     fSelectStart = fSelectEnd = -1;
 }
@@ -779,18 +849,16 @@ void YListBox::setFocusedItem(int item, bool clear, bool extend, bool virt) {
     }
 }
 
-bool YListBox::isSelected(int item) {
-    YListItem *a = getItem(item);
-    return a && isSelected(a);
-}
-
 bool YListBox::isSelected(YListItem *item) { // !!! remove this !!!
-    bool s = item->getSelected();
-    int n = findItem(item);
+    return isSelected(findItem(item));
+}
 
-    if (n == -1)
+bool YListBox::isSelected(int n) {
+    YListItem *item = getItem(n);
+    if (item == nullptr)
         return false;
 
+    bool s = item->getSelected();
     if (fDragging) {
         int beg = min(fSelectStart, fSelectEnd);
         int end = max(fSelectStart, fSelectEnd);
@@ -9,7 +9,7 @@ class YIcon;
 
 class YListItem {
 public:
-    YListItem() : fSelected(false) { }
+    YListItem() : fSelected(false), fIndex(-1), fWidth(-1) { }
     virtual ~YListItem() { }
 
     bool getSelected() { return fSelected; }
@@ -20,7 +20,10 @@ public:
     virtual mstring getText() { return null; }
     virtual ref<YIcon> getIcon() { return null; }
 private:
+    friend class YListBox;
     bool fSelected;
+    int fIndex;     // position in the list box when last numbered
+    int fWidth;     // getWidth, or -1 when unknown
 };
 
 class YListBox:
@@ -51,6 +54,7 @@ public:
 
     virtual void outdated();
     virtual void repaint();
+    virtual void releaseBuffers();
     virtual void paint(Graphics &g, const YRect &r);
     virtual void scroll(YScrollBar *sb, int delta);
     virtual void move(YScrollBar *sb, int pos);
@@ -62,7 +66,7 @@ public:
     int getItemCount() const { return fItems.getCount(); }
     YListItem *getItem(int item);
     int findItemByPoint(int x, int y);
-    int findItem(YListItem *item) const { return find(fItems, item); }
+    int findItem(YListItem *item);
     int getLineHeight();
 
     int maxWidth();
@@ -88,6 +92,8 @@ private:
     int fWidestItem;
     int fFocusedItem;
     int fSelectStart, fSelectEnd;
+    int fSelectedLow, fSelectedHigh;    // bounds of the selected items
+    int fNumbered;                      // items with a valid fIndex
     bool fDragging;
     bool fSelect;
     bool fVisible;
@@ -103,6 +109,11 @@ private:
     void setFocusedItem(int item, bool clear, bool extend, bool virt);
 
     void applySelection();
+    void markSelected(int beg, int end);
+    void inserted(int index);
+    void removed(int index);
+    int itemWidth(YListItem *item);
+    void scrollTo(int x, int y);
     void paintItem(int i);
     void paintItem(Graphics &g, int n);
     void resetScrollBars();
@@ -214,12 +214,23 @@ YUChar *YLocale::unicodeString(const YLChar* lStr, size_t const lLen,
         return nullptr;
 
     YUChar* uStr(new YUChar[lLen + 1]);
+    uLen = unicodeString(lStr, lLen, uStr, lLen);
+    uStr[uLen] = 0;
+
+    return uStr;
+}
+
+// Convert into a buffer of uSize characters; return the number converted.
+size_t YLocale::unicodeString(const YLChar* lStr, size_t const lLen,
+                              YUChar* uStr, size_t const uSize)
+{
+    PRECONDITION(instance);
 #ifdef __NetBSD__
     const
 #endif
     char* inbuf((char *) lStr);
     char* outbuf((char *) uStr);
-    size_t inlen(lLen), outlen(4 * lLen);
+    size_t inlen(lLen), outlen(uSize * sizeof(YUChar));
 
     errno = 0;
     size_t count = iconv(instance->converter->unicode(),
@@ -232,10 +243,7 @@ YUChar *YLocale::unicodeString(const YLChar* lStr, size_t const lLen,
         }
     }
 
-    *((YUChar *) outbuf) = 0;
-    uLen = ((YUChar *) outbuf) - uStr;
-
-    return uStr;
+    return ((YUChar *) outbuf) - uStr;
 }
 #endif
 
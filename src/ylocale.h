@@ -24,6 +24,8 @@ public:
 #ifdef CONFIG_I18N
     static YLChar* localeString(YUChar const* uStr, size_t uLen, size_t& lLen);
     static YUChar* unicodeString(YLChar const* lStr, size_t lLen, size_t& uLen);
+    static size_t unicodeString(YLChar const* lStr, size_t lLen,
+                                YUChar* uStr, size_t uSize);
 #endif
 
 private:
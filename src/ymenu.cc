@@ -11,6 +11,9 @@
 #include "yprefs.h"
 #include "ascii.h"
 #include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 static YColorName menuBg(&clrNormalMenu);
 static YColorName menuItemFg(&clrNormalMenuItemText);
@@ -36,6 +39,96 @@ int YMenu::fAutoScrollMouseY = -1;
 int YMenu::fMenuObjectCount;
 YMenu *YMenu::fPointedMenu = nullptr;
 
+/*
+ * Type-ahead narrows a menu to the items whose name contains the typed
+ * text, ignoring case. The names are folded once when typing starts.
+ * Each key only tests the items which still match, and a sorted index
+ * gives the first item which starts with the text.
+ */
+class YMenuFilter {
+public:
+    explicit YMenuFilter(const YMenu* menu);
+
+    bool hidden(int item) const { return fShown[item] == false; }
+    // Append c to the text, unless no item would match.
+    bool extend(char c);
+    // Remove the last character, unless the text would become empty.
+    bool shrink();
+    // The item to select for the text.
+    int best() const;
+
+private:
+    std::string fText;
+    std::vector<std::string> fNames;    // empty for inactive items
+    std::vector<int> fSorted;           // active items by name
+    std::vector<bool> fShown;
+
+    void match(const std::string& text, std::vector<bool>& shown) const;
+};
+
+YMenuFilter::YMenuFilter(const YMenu* menu) {
+    const int count = menu->itemCount();
+    fNames.resize(count);
+    fShown.resize(count);
+    for (int i = 0; i < count; i++) {
+        const YMenuItem* item = menu->getItem(i);
+        if (item->getName() != null &&
+            (item->getAction() != actionNull || item->getSubmenu()))
+        {
+            mstring name(item->getName());
+            std::string& fold = fNames[i];
+            fold.assign(name.c_str(), name.length());
+            for (char& c : fold)
+                c = ASCII::toLower(c);
+            fSorted.push_back(i);
+        }
+        fShown[i] = (fNames[i].empty() == false);
+    }
+    std::sort(fSorted.begin(), fSorted.end(), [this] (int a, int b) {
+        return fNames[a] < fNames[b];
+    });
+}
+
+void YMenuFilter::match(const std::string& text,
+                        std::vector<bool>& shown) const
+{
+    for (size_t i = 0; i < fNames.size(); ++i)
+        shown[i] = shown[i] && fNames[i].find(text) != std::string::npos;
+}
+
+bool YMenuFilter::extend(char c) {
+    std::string text(fText + ASCII::toLower(c));
+    std::vector<bool> shown(fShown);
+    match(text, shown);
+    if (std::find(shown.begin(), shown.end(), true) == shown.end())
+        return false;
+    fText.swap(text);
+    fShown.swap(shown);
+    return true;
+}
+
+bool YMenuFilter::shrink() {
+    if (fText.length() <= 1)
+        return false;
+    fText.erase(fText.length() - 1);
+    for (size_t i = 0; i < fNames.size(); ++i)
+        fShown[i] = (fNames[i].empty() == false);
+    match(fText, fShown);
+    return true;
+}
+
+int YMenuFilter::best() const {
+    auto it = std::lower_bound(fSorted.begin(), fSorted.end(), fText,
+        [this] (int item, const std::string& text) {
+            return fNames[item] < text;
+        });
+    if (it != fSorted.end() &&
+        fNames[*it].compare(0, fText.length(), fText) == 0)
+        return *it;
+    auto shown = std::find(fShown.begin(), fShown.end(), true);
+    return shown != fShown.end() ? int(shown - fShown.begin()) : -1;
+}
+
 void YMenu::setActionListener(YActionListener *actionListener) {
     fActionListener = actionListener;
 }
@@ -53,6 +146,9 @@ lazy<YTimer> YMenu::fMenuTimer;
 
 YMenu::YMenu(YWindow *parent):
     YPopupWindow(parent),
+    fFilter(nullptr),
+    fPaintTop(0),
+    fPaintBottom(0),
     fGraphics(this),
     fGradient(null),
     fMenusel(null)
@@ -113,6 +209,12 @@ void YMenu::activatePopup(int flags) {
 
 void YMenu::deactivatePopup() {
     hideSubmenu();
+    if (fFilter) {
+        delete fFilter; fFilter = nullptr;
+        fItemTops.clear();
+    }
+    fGraphics.release();
+    fPaintTop = fPaintBottom = 0;
     if (fPointedMenu == this)
         fPointedMenu = nullptr;
     if (fMenuTimer)
@@ -247,8 +349,8 @@ int YMenu::findActiveItem(int cur, int direction) {
         c += direction;
         if (c < 0) c = itemCount() - 1;
         if (c >= itemCount()) c = 0;
-    } while (c != cur && (getItem(c)->getAction() == actionNull &&
-                          !getItem(c)->getSubmenu()));
+    } while (c != cur && ((getItem(c)->getAction() == actionNull &&
+                           !getItem(c)->getSubmenu()) || hidden(c)));
     return c;
 }
 
@@ -319,7 +421,10 @@ bool YMenu::handleKey(const XKeyEvent &key) {
     if (key.type == KeyPress) {
         if ((m & ~ShiftMask) == 0) {
             if (k == XK_Escape) {
-                cancelPopup();
+                if (fFilter)
+                    clearFilter();
+                else
+                    cancelPopup();
             } else if (k == XK_Left || k == XK_KP_Left) {
                 if (prevPopup())
                     cancelPopup();
@@ -367,10 +472,19 @@ bool YMenu::handleKey(const XKeyEvent &key) {
                         activateItem(key.state, false);
                         return true;
                     }
+                } else if (k == XK_BackSpace && fFilter) {
+                    if (fFilter->shrink())
+                        narrowItems();
+                    else
+                        clearFilter();
                 } else if (k < 256) {
-                    if (findHotItem(ASCII::toUpper((char)k)) == 1) {
+                    int hot = fFilter ? 0 : findHotItem(ASCII::toUpper((char)k));
+                    if (hot == 1) {
                         activateItem(key.state, false);
                     }
+                    else if (hot == 0 && ASCII::isPrint((char)k)) {
+                        typeAhead((char)k);
+                    }
                     return true;
                 }
             }
@@ -685,11 +799,13 @@ void YMenu::removeAll() {
         }
     }
     fItems.clear();
+    itemsChanged();
     // paintedItem = selectedItem = -1;
 }
 
 YMenuItem * YMenu::add(YMenuItem *item) {
     if (item) fItems.append(item);
+    itemsChanged();
     return item;
 }
 
@@ -701,10 +817,12 @@ YMenuItem * YMenu::add(YMenuItem *item, const char *icons) {
         }
         fItems.append(item);
     }
+    itemsChanged();
     return item;
 }
 
 YMenuItem * YMenu::addSorted(YMenuItem *item, bool duplicates, bool ignoreCase) {
+    itemsChanged();
     for (int i = 0; i < itemCount(); i++) {
         if (item->getName() == null || fItems[i]->getName() == null)
             continue;
@@ -812,37 +930,104 @@ int YMenu::findItemPos(int itemNo, int &x, int &y, unsigned &ih) {
         return -1;
 
     unsigned w, h;
-    int top, bottom, pad;
 
     getArea(x, y, w, h);
-    for (int i = 0; i < itemNo; i++) {
-        y += getItem(i)->queryHeight(top, bottom, pad);
-    }
+    layoutItems();
+    y = fItemTops[itemNo];
     if (itemNo < itemCount())
-        ih = getItem(itemNo)->queryHeight(top, bottom, pad);
+        ih = unsigned(fItemTops[itemNo + 1] - y);
 
     return 0;
 }
 
 int YMenu::findItem(int mx, int my) {
+    if (inrange(mx, 1, int(width()) - 1) == false)
+        return -1;
+
+    layoutItems();
+    const int* tops = fItemTops.begin();
+    const int* next = std::upper_bound(tops, fItemTops.end(), my);
+    const int i = int(next - tops) - 1;
+    if (i < 0 || i >= itemCount() || fItems[i]->isSeparator())
+        return -1;
+
+    return i;
+}
+
+// The offsets of all items are kept until the items change,
+// such that finding and painting an item does not visit all of them.
+void YMenu::layoutItems() {
+    if (fItemTops.nonempty())
+        return;
+
     int x, y;
     unsigned w, h;
-
     getArea(x, y, w, h);
-    for (int i = 0; i < itemCount(); i++, y += int(h)) {
-        int top, bottom, pad;
 
-        h = fItems[i]->queryHeight(top, bottom, pad);
-
-        if (inrange(my, y, y + int(h)) && inrange(mx, 1, int(width()) - 1)) {
-            if (!fItems[i]->isSeparator())
-                return i;
-            else
-                return -1;
+    const int count = itemCount();
+    fItemTops.setCapacity(count + 1);
+    for (int i = 0; i < count; i++) {
+        fItemTops.append(y);
+        if (hidden(i) == false) {
+            int top, bottom, pad;
+            y += fItems[i]->queryHeight(top, bottom, pad);
         }
     }
+    fItemTops.append(y);
+}
 
-    return -1;
+void YMenu::itemsChanged() {
+    fItemTops.clear();
+    if (fFilter) {
+        delete fFilter; fFilter = nullptr;
+    }
+}
+
+bool YMenu::hidden(int item) const {
+    return fFilter && fFilter->hidden(item);
+}
+
+void YMenu::typeAhead(char c) {
+    bool created = (fFilter == nullptr);
+    if (created)
+        fFilter = new YMenuFilter(this);
+    if (fFilter->extend(c))
+        narrowItems();
+    else if (created) {
+        delete fFilter; fFilter = nullptr;
+    }
+}
+
+void YMenu::clearFilter() {
+    delete fFilter; fFilter = nullptr;
+    narrowItems();
+}
+
+// Fit the menu to the items which pass the filter and select the best.
+void YMenu::narrowItems() {
+    hideSubmenu();
+    fItemTops.clear();
+    layoutItems();
+
+    int l, t, r, b;
+    getOffsets(l, t, r, b);
+    const int h = fItemTops[itemCount()] + b;
+
+    int dx, dy;
+    unsigned uw, uh;
+    desktop->getScreenGeometry(&dx, &dy, &uw, &uh, getXiScreen());
+    int ny = y();
+    if (ny + h > dy + int(uh))
+        ny = max(dy, dy + int(uh) - h);
+
+    selectedItem = paintedItem = -1;
+    if (h == int(height())) {
+        setPosition(x(), ny);
+        repaint();
+    } else {
+        setGeometry(YRect(x(), ny, width(), unsigned(h)));
+    }
+    focusItem(fFilter ? fFilter->best() : findActiveItem(itemCount() - 1, 1));
 }
 
 void YMenu::sizePopup(int hspace) {
@@ -861,6 +1046,7 @@ void YMenu::sizePopup(int hspace) {
 
     int height = t;
 
+    itemsChanged();
     for (int i = 0; i < itemCount(); i++) {
         const YMenuItem *mitem = getItem(i);
 
@@ -919,7 +1105,7 @@ void YMenu::repaintItem(int item) {
     unsigned h;
 
     if (findItemPos(item, x, y, h) != -1)
-        fGraphics.paint(YRect(0, y, width(), h));
+        invalidateRect(YRect(0, y, width(), h));
 }
 
 void YMenu::paintItems() {
@@ -1115,7 +1301,7 @@ void YMenu::paintItem(Graphics &g, const int i, const int l, const int t, const
                     int dx = l + 1 + delta;
                     int dy = t + delta + top + pad +
                                (eh - top - pad * 2 - bottom - size) / 2;
-                    mitem->getIcon()->draw(g, dx, dy, size);
+                    mitem->getIcon()->draw(g, dx, dy, size, this);
                 }
 
                 if (name != null) {
@@ -1220,21 +1406,15 @@ void YMenu::paint(Graphics &g, const YRect &r1) {
 
     int l, t, r, b;
     getOffsets(l, t, r, b);
-    int x, y;
-    unsigned w, h;
-    getArea(x, y, w, h);
-    int iy = y;
-    int top, bottom, pad;
+    layoutItems();
 
-    for (int i = 0; i < itemCount(); i++) {
-        int ih = getItem(i)->queryHeight(top, bottom, pad);
+    const int minY = r1.y(), maxY = r1.y() + int(r1.height());
+    const int* tops = fItemTops.begin();
+    const int first = int(std::upper_bound(tops, fItemTops.end(), minY) - tops);
 
-        if (iy < r1.y() + (int) r1.height() &&
-            iy + (int) ih > r1.y())
-        {
-            paintItem(g, i, l, iy, r, r1.y(), r1.y() + r1.height(), true);
-        }
-        iy += ih;
+    for (int i = max(0, first - 1); i < itemCount() && tops[i] < maxY; i++) {
+        if (tops[i] < tops[i + 1])
+            paintItem(g, i, l, tops[i], r, minY, maxY, true);
     }
 }
 
@@ -1250,11 +1430,43 @@ void YMenu::configure(const YRect2& r) {
     if (r.resized()) {
         repaint();
     }
+    else if (r.moved()) {
+        paintVisible();
+    }
 }
 
 void YMenu::repaint() {
     fGraphics.release();
-    fGraphics.paint();
+    fPaintTop = fPaintBottom = 0;
+    paintVisible();
+}
+
+// A tall menu is only painted where it is on the desktop.
+// The rest is painted when scrolling brings it into view.
+void YMenu::paintVisible() {
+    const int h = int(height());
+    const int top = clamp(-y(), 0, h);
+    const int bottom = clamp(int(desktop->height()) - y(), top, h);
+    if (top == bottom || (fPaintTop <= top && bottom <= fPaintBottom))
+        return;
+
+    if (fPaintTop == fPaintBottom || bottom < fPaintTop || fPaintBottom < top) {
+        fGraphics.paint(YRect(0, top, width(), unsigned(bottom - top)));
+        fPaintTop = top;
+        fPaintBottom = bottom;
+    } else {
+        if (top < fPaintTop)
+            fGraphics.paint(YRect(0, top, width(), unsigned(fPaintTop - top)));
+        if (fPaintBottom < bottom)
+            fGraphics.paint(YRect(0, fPaintBottom, width(),
+                                  unsigned(bottom - fPaintBottom)));
+        fPaintTop = min(fPaintTop, top);
+        fPaintBottom = max(fPaintBottom, bottom);
+    }
+}
+
+void YMenu::repaintRect(const YRect& r) {
+    fGraphics.paint(r);
 }
 
 // vim: set sw=4 ts=4 et:
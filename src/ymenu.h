@@ -7,6 +7,7 @@
 class YAction;
 class YActionListener;
 class YMenuItem;
+class YMenuFilter;
 
 class YMenu: public YPopupWindow, public YTimerListener {
 public:
@@ -28,6 +29,7 @@ public:
     virtual void configure(const YRect2& r2);
     virtual void handleExpose(const XExposeEvent &expose) {}
     virtual void repaint();
+    virtual void repaintRect(const YRect& r);
 
     void trackMotion(const int x_root, const int y_root, const unsigned state, bool submenu);
 
@@ -58,7 +60,7 @@ public:
     bool lastIsSeparator() const;
     YMenuItem *lastItem() const;
     YMenuItem *getItem(int n) const { return fItems[n]; }
-    void setItem(int n, YMenuItem *ref) { fItems[n] = ref; return; }
+    void setItem(int n, YMenuItem *ref) { fItems[n] = ref; itemsChanged(); }
 
     bool isShared() const { return fShared; }
     void setShared(bool shared) { fShared = shared; }
@@ -71,6 +73,9 @@ public:
 
 private:
     YObjectArray<YMenuItem> fItems;
+    YArray<int> fItemTops;      // offsets of the items and of their end
+    YMenuFilter* fFilter;       // the typed text which narrows the items
+    int fPaintTop, fPaintBottom;    // band which is painted in fGraphics
     int selectedItem;
     int paintedItem;
     int paramPos;
@@ -108,6 +113,13 @@ private:
 
     void repaintItem(int item);
     void paintItems();
+    void paintVisible();
+    void layoutItems();
+    void itemsChanged();
+    bool hidden(int item) const;
+    void typeAhead(char c);
+    void narrowItems();
+    void clearFilter();
     int findItemPos(int item, int &x, int &y, unsigned &h);
     int findItem(int x, int y);
     int findActiveItem(int cur, int direction);
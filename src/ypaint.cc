@@ -9,6 +9,7 @@
 #include "yprefs.h"
 #include "ascii.h"
 #include "intl.h"
+#include "yxcontext.h"
 #include <stdlib.h>
 
 #ifdef CONFIG_XFREETYPE
@@ -1083,6 +1084,181 @@ void Graphics::maxOpacity() {
 
 /******************************************************************************/
 
+/******************************************************************************/
+/******************************************************************************/
+
+// An off-screen pixmap which is shared between all GraphicsBuffers.
+// While it is the background of a window it is not available for reuse.
+struct PooledPixmap {
+    Pixmap pixmap;
+    unsigned width, height, depth;
+    YWindow* owner;     // window which has this as background pixmap
+    bool busy;          // held by a GraphicsBuffer
+
+    PooledPixmap(unsigned w, unsigned h, unsigned d) :
+        pixmap(XCreatePixmap(display(), xapp->root(), w, h, d)),
+        width(w), height(h), depth(d), owner(nullptr), busy(false)
+    { }
+    ~PooledPixmap() {
+        if (pixmap && xapp)
+            XFreePixmap(display(), pixmap);
+    }
+
+    unsigned long bytes() const {
+        return (unsigned long) width * height
+             * (depth > 16 ? 4 : depth > 8 ? 2 : 1);
+    }
+    bool matches(unsigned w, unsigned h, unsigned d) const {
+        return width == w && height == h && depth == d;
+    }
+};
+
+// Pixmaps are kept in buckets of rounded sizes and reused in LRU order.
+class PixmapPool {
+public:
+    PixmapPool() : fBudget(4UL << 20), fFreeBytes(0),
+                   fCreated(0), fReused(0) { }
+    ~PixmapPool();
+
+    PooledPixmap* acquire(unsigned width, unsigned height, unsigned depth);
+    void release(PooledPixmap* pooled);
+    void attach(PooledPixmap* pooled, YWindow* window);
+    void detach(YWindow* window);
+
+    unsigned long created() const { return fCreated; }
+    unsigned long reused() const { return fReused; }
+
+private:
+    static unsigned bucket(unsigned n) {
+        return n <= 64 ? (n + 7) & ~7U
+             : n <= 512 ? (n + 31) & ~31U
+             : (n + 127) & ~127U;
+    }
+    PooledPixmap* reclaim(unsigned width, unsigned height, unsigned depth);
+    void recycle(PooledPixmap* pooled);
+    void trim();
+
+    YArray<PooledPixmap*> fFree;        // least recently used first
+    YArray<PooledPixmap*> fUsed;
+    YContext<PooledPixmap> fAttached;   // window to background pixmap
+    const unsigned long fBudget;
+    unsigned long fFreeBytes;
+    unsigned long fCreated;
+    unsigned long fReused;
+};
+
+static PixmapPool pixmapPool;
+
+PixmapPool::~PixmapPool() {
+    for (PooledPixmap* pooled : fFree)
+        delete pooled;
+    for (PooledPixmap* pooled : fUsed)
+        delete pooled;
+}
+
+PooledPixmap* PixmapPool::acquire(unsigned width, unsigned height,
+                                  unsigned depth)
+{
+    const unsigned w = bucket(width), h = bucket(height);
+    PooledPixmap* pooled = nullptr;
+    for (int i = fFree.getCount(); --i >= 0; ) {
+        if (fFree[i]->matches(w, h, depth)) {
+            pooled = fFree[i];
+            fFree.remove(i);
+            fFreeBytes -= pooled->bytes();
+            break;
+        }
+    }
+    if (pooled == nullptr)
+        pooled = reclaim(w, h, depth);
+    if (pooled) {
+        ++fReused;
+    } else {
+        pooled = new PooledPixmap(w, h, depth);
+        ++fCreated;
+    }
+    pooled->busy = true;
+    fUsed.append(pooled);
+    return pooled;
+}
+
+// Take away the background pixmap of a hidden window.
+PooledPixmap* PixmapPool::reclaim(unsigned width, unsigned height,
+                                  unsigned depth)
+{
+    for (PooledPixmap* pooled : fUsed) {
+        YWindow* owner = pooled->owner;
+        if (pooled->busy == false && owner && owner->viewable() == false &&
+            pooled->matches(width, height, depth))
+        {
+            fAttached.remove(owner->handle());
+            pooled->owner = nullptr;
+            owner->setBackgroundPixmap(None);
+            owner->repaintOnShow();
+            findRemove(fUsed, pooled);
+            return pooled;
+        }
+    }
+    return nullptr;
+}
+
+void PixmapPool::release(PooledPixmap* pooled) {
+    pooled->busy = false;
+    recycle(pooled);
+}
+
+void PixmapPool::attach(PooledPixmap* pooled, YWindow* window) {
+    PooledPixmap* previous = fAttached.find(window->handle());
+    if (previous != pooled) {
+        if (previous) {
+            previous->owner = nullptr;
+            recycle(previous);
+        }
+        pooled->owner = window;
+        fAttached.save(window->handle(), pooled);
+    }
+}
+
+void PixmapPool::detach(YWindow* window) {
+    PooledPixmap* pooled = fAttached.find(window->handle());
+    if (pooled) {
+        fAttached.remove(window->handle());
+        pooled->owner = nullptr;
+        recycle(pooled);
+    }
+}
+
+void PixmapPool::recycle(PooledPixmap* pooled) {
+    if (pooled->busy == false && pooled->owner == nullptr) {
+        findRemove(fUsed, pooled);
+        fFree.append(pooled);
+        fFreeBytes += pooled->bytes();
+        trim();
+    }
+}
+
+void PixmapPool::trim() {
+    while (fFreeBytes > fBudget && fFree.nonempty()) {
+        PooledPixmap* oldest = fFree[0];
+        fFree.remove(0);
+        fFreeBytes -= oldest->bytes();
+        delete oldest;
+    }
+}
+
+void GraphicsBuffer::detach(YWindow* window) {
+    if (xapp && window->created())
+        pixmapPool.detach(window);
+}
+
+unsigned long GraphicsBuffer::pixmapsCreated() {
+    return pixmapPool.created();
+}
+
+unsigned long GraphicsBuffer::pixmapsReused() {
+    return pixmapPool.reused();
+}
+
 void GraphicsBuffer::paint(Pixmap pixmap, const YRect& rect) {
     if (window()->handle() && window()->destroyed())
         return;
@@ -1118,9 +1294,12 @@ void GraphicsBuffer::paint(Pixmap pixmap, const YRect& rect) {
     window()->paint(gfx, rect);
 
     if (fNesting == 1) {
-        if (pixmap == fPixmap && !window()->destroyed()) {
+        if (fBuffer && pixmap == fBuffer->pixmap &&
+            !window()->destroyed())
+        {
             window()->setBackgroundPixmap(pixmap);
             window()->clearArea(x, y, w, h);
+            pixmapPool.attach(fBuffer, window());
         }
         if (clipping) {
             gfx.resetClip();
@@ -1131,9 +1310,9 @@ void GraphicsBuffer::paint(Pixmap pixmap, const YRect& rect) {
 }
 
 void GraphicsBuffer::release() {
-    if (fPixmap) {
-        XFreePixmap(display(), fPixmap);
-        fPixmap = None;
+    if (fBuffer) {
+        pixmapPool.release(fBuffer);
+        fBuffer = nullptr;
     }
 }
 
@@ -1143,7 +1322,15 @@ GraphicsBuffer::~GraphicsBuffer() {
 
 void GraphicsBuffer::paint(const YRect& rect) {
     if (0 < window()->width() && 0 < window()->height()) {
-        GraphicsBuffer::paint(pixmap(), rect);
+        Pixmap p = pixmap();
+        // a pixmap from the pool still shows what it was used for before
+        if (fFresh && fNesting == 0) {
+            fFresh = false;
+            GraphicsBuffer::paint(p, YRect(0, 0, window()->width(),
+                                           window()->height()));
+        } else {
+            GraphicsBuffer::paint(p, rect);
+        }
     }
 }
 
@@ -1152,13 +1339,43 @@ void GraphicsBuffer::paint() {
     paint(rect);
 }
 
+void GraphicsBuffer::scroll(int dx, int dy) {
+    const int w = int(window()->width());
+    const int h = int(window()->height());
+    if (dx == 0 && dy == 0)
+        return;
+    if (fBuffer == nullptr || fBuffer->depth != window()->depth() ||
+        int(fBuffer->width) < w || int(fBuffer->height) < h ||
+        abs(dx) >= w || abs(dy) >= h || fNesting > 0)
+    {
+        paint();
+        return;
+    }
+
+    Graphics gfx(fBuffer->pixmap, unsigned(w), unsigned(h),
+                 window()->depth());
+    gfx.copyArea(max(dx, 0), max(dy, 0), w - abs(dx), h - abs(dy),
+                 max(-dx, 0), max(-dy, 0));
+
+    if (dy)
+        paint(fBuffer->pixmap, YRect(0, dy > 0 ? h - dy : 0, w, abs(dy)));
+    if (dx)
+        paint(fBuffer->pixmap, YRect(dx > 0 ? w - dx : 0, 0, abs(dx), h));
+    window()->clearArea(0, 0, w, h);
+}
+
 Pixmap GraphicsBuffer::pixmap() {
-    if (fPixmap == None || fDim != window()->dimension()) {
-        if (fPixmap) XFreePixmap(display(), fPixmap);
-        fPixmap = window()->createPixmap();
-        fDim = window()->dimension();
+    const unsigned w = window()->width();
+    const unsigned h = window()->height();
+    const unsigned d = window()->depth();
+    if (fBuffer == nullptr || fBuffer->depth != d ||
+        fBuffer->width < w || fBuffer->height < h)
+    {
+        release();
+        fBuffer = pixmapPool.acquire(w, h, d);
+        fFresh = true;
     }
-    return fPixmap;
+    return fBuffer->pixmap;
 }
 
 /******************************************************************************/
@@ -216,31 +216,39 @@ private:
 /******************************************************************************/
 /******************************************************************************/
 
+struct PooledPixmap;
+
 class GraphicsBuffer {
 public:
     GraphicsBuffer(YWindow* ywindow, bool clipping = false) :
         fWindow(ywindow),
         fClipping(clipping),
         fNesting(0),
-        fPixmap(None),
-        fDim(0, 0)
+        fBuffer(nullptr),
+        fFresh(false)
     {
     }
     ~GraphicsBuffer();
     void paint(const class YRect& rect);
     void paint();
+    // Move the contents by -dx, -dy and paint only what was uncovered.
+    void scroll(int dx, int dy);
     void release();
 
     YWindow* window() const { return fWindow; }
     int nesting() const { return fNesting; }
-    bool operator!() const { return !fPixmap; }
+    bool operator!() const { return !fBuffer; }
+
+    static void detach(YWindow* window);
+    static unsigned long pixmapsCreated();
+    static unsigned long pixmapsReused();
 
 private:
     YWindow* fWindow;
     bool fClipping;
     int fNesting;
-    Pixmap fPixmap;
-    YDimension fDim;
+    PooledPixmap* fBuffer;
+    bool fFresh;        // acquired, but not yet painted in full
 
     Pixmap pixmap();
     void paint(Pixmap p, const class YRect& rect);
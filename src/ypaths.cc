@@ -84,9 +84,10 @@ void YResourcePaths::verifyPaths(upath base) {
 }
 
 template<class Pict>
-bool YResourcePaths::loadPictFile(upath file, ref<Pict>* pict) {
+bool YResourcePaths::loadPictFile(upath file, ref<Pict>* pict,
+                                  unsigned width, unsigned height) {
     if (file.isReadable()) {
-        *pict = Pict::load(file);
+        *pict = Pict::load(file, width, height);
         if (*pict != null) {
             return true;
         }
@@ -106,10 +107,11 @@ ref<YImage> YResourcePaths::loadImageFile(const upath& file) {
 }
 
 template<class Pict>
-bool YResourcePaths::loadPict(upath baseName, ref<Pict>* pict) const {
+bool YResourcePaths::loadPict(upath baseName, ref<Pict>* pict,
+                              unsigned width, unsigned height) const {
     for (int i = 0; i < getCount(); ++i) {
         upath path = getPath(i) + baseName;
-        if (path.fileExists() && loadPictFile(path, pict))
+        if (path.fileExists() && loadPictFile(path, pict, width, height))
             return true;
     }
 #ifdef DEBUG
@@ -120,14 +122,16 @@ bool YResourcePaths::loadPict(upath baseName, ref<Pict>* pict) const {
 }
 
 
-ref<YPixmap> YResourcePaths::loadPixmap(upath base, upath name) const {
+ref<YPixmap> YResourcePaths::loadPixmap(upath base, upath name,
+                                        unsigned width, unsigned height) const {
     ref<YPixmap> p;
-    return loadPict(base + name, &p) && p->pixmap() ? p : null;
+    return loadPict(base + name, &p, width, height) && p->pixmap() ? p : null;
 }
 
-ref<YImage> YResourcePaths::loadImage(upath base, upath name) const {
+ref<YImage> YResourcePaths::loadImage(upath base, upath name,
+                                      unsigned width, unsigned height) const {
     ref<YImage> p;
-    return loadPict(base + name, &p) && p->valid() ? p : null;
+    return loadPict(base + name, &p, width, height) && p->valid() ? p : null;
 }
 
 // vim: set sw=4 ts=4 et:
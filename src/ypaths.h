@@ -16,8 +16,10 @@ class YResourcePaths: public refcounted {
 public:
     static ref<YResourcePaths> subdirs(upath subdir, bool themeOnly = false);
 
-    ref<YPixmap> loadPixmap(upath base, upath name) const;
-    ref<YImage> loadImage(upath base, upath name) const;
+    ref<YPixmap> loadPixmap(upath base, upath name,
+                            unsigned width = 0, unsigned height = 0) const;
+    ref<YImage> loadImage(upath base, upath name,
+                          unsigned width = 0, unsigned height = 0) const;
 
     static ref<YPixmap> loadPixmapFile(const upath& file);
     static ref<YImage> loadImageFile(const upath& file);
@@ -40,9 +42,11 @@ private:
     void addDir(upath dir);
 
     template<class Pict>
-    bool loadPict(upath baseName, ref<Pict>* pict) const;
+    bool loadPict(upath baseName, ref<Pict>* pict,
+                  unsigned width = 0, unsigned height = 0) const;
     template<class Pict>
-    static bool loadPictFile(upath file, ref<Pict>* pict);
+    static bool loadPictFile(upath file, ref<Pict>* pict,
+                             unsigned width = 0, unsigned height = 0);
 };
 
 #endif
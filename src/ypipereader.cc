@@ -1,6 +1,7 @@
 #include "config.h"
 #include "ypipereader.h"
 #include "yapp.h"
+#include "yspawn.h"
 
 #include <unistd.h>
 #include <errno.h>
@@ -25,32 +26,22 @@ void YPipeReader::pipeClose() {
 }
 
 int YPipeReader::spawnvp(const char *prog, char **args) {
-    int fds[2], rc;
+    int fds[2];
 
     if (pipe(fds) == -1)
         return -1;
 
-    if ((rc = fork()) == -1) {
+    YSpawn spawn;
+    spawn.nullInput();
+    spawn.output(fds[1]);
+    spawn.closeFile(fds[0]);
+    if (spawn.spawn(prog, args, true) == -1) {
         close(fds[0]);
         close(fds[1]);
         return -1;
-    } else if (rc == 0) { // child
-        close(fds[0]);
-        int devnull = open("/dev/null", O_RDONLY);
-        if (devnull > 0) {
-            dup2(devnull, 0);
-            close(devnull);
-        }
-        if (fds[1] != 1) {
-            dup2(fds[1], 1);
-            close(fds[1]);
-        }
-        execvp(prog, args);
-        _exit(99);
-    } else { // parent
-        close(fds[1]);
-        registerPoll(fds[0]);
     }
+    close(fds[1]);
+    registerPoll(fds[0]);
     return 0;
 }
 
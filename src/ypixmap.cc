@@ -189,10 +189,10 @@ ref<YPixmap> YPixmap::createFromPixmapAndMaskScaled(Pixmap pix, Pixmap mask,
     return null;
 }
 
-ref<YPixmap> YPixmap::load(upath filename) {
+ref<YPixmap> YPixmap::load(upath filename, unsigned width, unsigned height) {
     ref<YPixmap> pixmap;
     if (filename != null) {
-        ref<YImage> image(YImage::load(filename));
+        ref<YImage> image(YImage::load(filename, width, height));
         if (image != null) {
             pixmap = YPixmap::createFromImage(image, xapp->depth());
         }
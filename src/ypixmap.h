@@ -12,7 +12,8 @@ class YImage;
 class YPixmap: public virtual refcounted {
 public:
     static ref<YPixmap> create(unsigned w, unsigned h, unsigned depth, bool mask = false);
-    static ref<YPixmap> load(upath filename);
+    static ref<YPixmap> load(upath filename,
+                             unsigned width = 0, unsigned height = 0);
 //    static ref<YPixmap> scale(ref<YPixmap> source, int width, int height);
     static ref<YPixmap> createFromImage(ref<YImage> image, unsigned depth);
     static ref<YPixmap> createFromPixmapAndMask(Pixmap pixmap,
@@ -0,0 +1,381 @@
+/*
+ * IceWM - fixed-point image scaling
+ *
+ * Images are scaled in two passes. Each source row is first filtered
+ * horizontally into a row of 16-bit channel values with 7 fraction bits.
+ * Then the rows are combined vertically into the destination pixels.
+ * Only as many filtered rows are kept as the vertical filter needs.
+ * Filter weights are 14-bit fixed point and sum to one for each pixel.
+ */
+#include "config.h"
+#include "base.h"
+#include "yscale.h"
+#include "ypointer.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCALE_X86 1
+#include <immintrin.h>
+#define TARGET(x) __attribute__((target(x)))
+#endif
+
+enum {
+    WeightBits = 14,
+    FractionBits = 7,
+    RowShift = WeightBits - FractionBits,
+    ColumnShift = WeightBits + FractionBits,
+    RowLimit = 255 << FractionBits,
+};
+
+// The weights of the source pixels for each destination pixel on one axis.
+class ScaleTaps {
+public:
+    ScaleTaps(unsigned source, unsigned target, YScaler::Filter filter);
+    ~ScaleTaps() {
+        delete[] fFirst;
+        delete[] fCount;
+        delete[] fWeights;
+    }
+
+    unsigned first(unsigned k) const { return fFirst[k]; }
+    int count(unsigned k) const { return fCount[k]; }
+    const int16_t* weights(unsigned k) const { return fWeights + k * fWidth; }
+    int maxCount() const { return fMaxCount; }
+
+private:
+    unsigned* fFirst;
+    int* fCount;
+    int16_t* fWeights;
+    unsigned fWidth;
+    int fMaxCount;
+
+    void store(unsigned k, unsigned first, double* weights, unsigned count);
+
+    static double triangle(double t) {
+        return t < 0 ? (t > -1 ? 1 + t : 0) : (t < 1 ? 1 - t : 0);
+    }
+    static double lanczos(double t) {
+        if (t == 0)
+            return 1;
+        if (t <= -3 || t >= 3)
+            return 0;
+        double p = M_PI * t;
+        return 3 * sin(p) * sin(p / 3) / (p * p);
+    }
+};
+
+ScaleTaps::ScaleTaps(unsigned source, unsigned target, YScaler::Filter filter):
+    fFirst(new unsigned[target]),
+    fCount(new int[target]),
+    fWeights(nullptr),
+    fWidth(0),
+    fMaxCount(0)
+{
+    const double ratio = double(source) / target;
+    const double widen = ratio > 1 ? ratio : 1;
+    const double radius = (filter == YScaler::Lanczos ? 3 : 1) * widen;
+
+    if (filter == YScaler::Box)
+        fWidth = source / target + 2;
+    else
+        fWidth = unsigned(ceil(2 * radius)) + 2;
+    fWeights = new int16_t[target * fWidth];
+    asmart<double> weights(new double[fWidth]);
+
+    for (unsigned k = 0; k < target; ++k) {
+        if (filter == YScaler::Box) {
+            // The overlap of pixel k with source pixel i in units of
+            // 1 / target: [k * source, (k + 1) * source) with
+            // [i * target, (i + 1) * target).
+            const unsigned long long lo = 1ULL * k * source;
+            const unsigned long long hi = lo + source;
+            unsigned first = unsigned(lo / target);
+            unsigned last = unsigned((hi - 1) / target);
+            for (unsigned i = first; i <= last; ++i) {
+                unsigned long long start = max(lo, 1ULL * i * target);
+                unsigned long long end = min(hi, 1ULL * (i + 1) * target);
+                weights[i - first] = double(end - start);
+            }
+            store(k, first, weights, last - first + 1);
+        }
+        else {
+            const double center = (k + 0.5) * ratio - 0.5;
+            const int lo = int(ceil(center - radius));
+            const int hi = int(floor(center + radius));
+            const int first = max(lo, 0);
+            const int last = min(hi, int(source) - 1);
+            for (int i = first; i <= last; ++i)
+                weights[i - first] = 0;
+            for (int i = lo; i <= hi; ++i) {
+                double t = (i - center) / widen;
+                double w = filter == YScaler::Lanczos ? lanczos(t) : triangle(t);
+                weights[clamp(i, first, last) - first] += w;
+            }
+            store(k, unsigned(first), weights, unsigned(last - first + 1));
+        }
+    }
+}
+
+// Quantize weights so that they sum to exactly one and trim zero ends.
+void ScaleTaps::store(unsigned k, unsigned first, double* weights,
+                      unsigned count)
+{
+    double sum = 0;
+    for (unsigned i = 0; i < count; ++i)
+        sum += weights[i];
+
+    int16_t* fixed = fWeights + k * fWidth;
+    int total = 0;
+    unsigned largest = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        fixed[i] = int16_t(lround(weights[i] * (1 << WeightBits) / sum));
+        total += fixed[i];
+        if (fixed[largest] < fixed[i])
+            largest = i;
+    }
+    fixed[largest] += (1 << WeightBits) - total;
+
+    unsigned skip = 0;
+    while (count > 1 && fixed[skip] == 0)
+        ++skip, --count;
+    while (count > 1 && fixed[skip + count - 1] == 0)
+        --count;
+    if (skip)
+        memmove(fixed, fixed + skip, count * sizeof(*fixed));
+
+    fFirst[k] = first + skip;
+    fCount[k] = int(count);
+    fMaxCount = max(fMaxCount, int(count));
+}
+
+/******************************************************************************/
+
+typedef void (*RowFilter)(const ScaleTaps& taps, unsigned width,
+                          const uint32_t* src, int16_t* dst);
+typedef void (*ColumnFilter)(const int16_t* const* rows, const int16_t* weights,
+                             int count, unsigned from, unsigned width,
+                             uint32_t* dst);
+
+static void filterRowScalar(const ScaleTaps& taps, unsigned width,
+                            const uint32_t* src, int16_t* dst)
+{
+    for (unsigned k = 0; k < width; ++k, dst += 4) {
+        const uint32_t* pixel = src + taps.first(k);
+        const int16_t* weight = taps.weights(k);
+        const int count = taps.count(k);
+        for (int c = 0; c < 4; ++c) {
+            int sum = 1 << (RowShift - 1);
+            for (int i = 0; i < count; ++i)
+                sum += weight[i] * int((pixel[i] >> (8 * c)) & 0xFF);
+            dst[c] = int16_t(clamp(sum >> RowShift, 0, int(RowLimit)));
+        }
+    }
+}
+
+static void filterColumnsScalar(const int16_t* const* rows,
+                                const int16_t* weights, int count,
+                                unsigned from, unsigned width, uint32_t* dst)
+{
+    for (unsigned x = from; x < width; ++x) {
+        uint32_t pixel = 0;
+        for (unsigned c = 0; c < 4; ++c) {
+            int sum = 1 << (ColumnShift - 1);
+            for (int i = 0; i < count; ++i)
+                sum += weights[i] * rows[i][4 * x + c];
+            pixel |= uint32_t(clamp(sum >> ColumnShift, 0, 255)) << (8 * c);
+        }
+        dst[x] = pixel;
+    }
+}
+
+#ifdef SCALE_X86
+
+// Two weights for _mm_madd_epi16 over interleaved channel values.
+static inline int weightPair(int16_t a, int16_t b) {
+    return int(uint16_t(a) | uint32_t(uint16_t(b)) << 16);
+}
+
+TARGET("sse2")
+static void filterRowSSE2(const ScaleTaps& taps, unsigned width,
+                          const uint32_t* src, int16_t* dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (RowShift - 1));
+    const __m128i limit = _mm_set1_epi16(RowLimit);
+
+    for (unsigned k = 0; k < width; ++k, dst += 4) {
+        const uint32_t* pixel = src + taps.first(k);
+        const int16_t* weight = taps.weights(k);
+        const int count = taps.count(k);
+        __m128i sum = half;
+        int i = 0;
+        for (; i + 1 < count; i += 2) {
+            // two pixels as 16-bit channels a0 a1 b0 b1 c0 c1 d0 d1
+            __m128i p = _mm_loadl_epi64((const __m128i *) (pixel + i));
+            p = _mm_unpacklo_epi8(p, zero);
+            p = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+            __m128i w = _mm_set1_epi32(weightPair(weight[i], weight[i + 1]));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(p, w));
+        }
+        if (i < count) {
+            __m128i p = _mm_cvtsi32_si128(int(pixel[i]));
+            p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(p, zero), zero);
+            __m128i w = _mm_set1_epi32(weightPair(weight[i], 0));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(p, w));
+        }
+        sum = _mm_srai_epi32(sum, RowShift);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_min_epi16(_mm_max_epi16(sum, zero), limit);
+        _mm_storel_epi64((__m128i *) dst, sum);
+    }
+}
+
+TARGET("sse2")
+static void filterColumnsSSE2(const int16_t* const* rows,
+                              const int16_t* weights, int count,
+                              unsigned from, unsigned width, uint32_t* dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (ColumnShift - 1));
+    const unsigned size = 4 * width;
+    unsigned x = 4 * from;
+
+    for (; x + 8 <= size; x += 8) {
+        __m128i lo = half, hi = half;
+        int i = 0;
+        for (; i + 1 < count; i += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i *) (rows[i] + x));
+            __m128i b = _mm_loadu_si128((const __m128i *) (rows[i + 1] + x));
+            __m128i w = _mm_set1_epi32(weightPair(weights[i], weights[i + 1]));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        if (i < count) {
+            __m128i a = _mm_loadu_si128((const __m128i *) (rows[i] + x));
+            __m128i w = _mm_set1_epi32(weightPair(weights[i], 0));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), w));
+        }
+        lo = _mm_srai_epi32(lo, ColumnShift);
+        hi = _mm_srai_epi32(hi, ColumnShift);
+        __m128i r = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *) (dst + x / 4), _mm_packus_epi16(r, r));
+    }
+    filterColumnsScalar(rows, weights, count, x / 4, width, dst);
+}
+
+TARGET("avx2")
+static void filterColumnsAVX2(const int16_t* const* rows,
+                              const int16_t* weights, int count,
+                              unsigned from, unsigned width, uint32_t* dst)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i half = _mm256_set1_epi32(1 << (ColumnShift - 1));
+    const unsigned size = 4 * width;
+    unsigned x = 4 * from;
+
+    for (; x + 16 <= size; x += 16) {
+        __m256i lo = half, hi = half;
+        int i = 0;
+        for (; i + 1 < count; i += 2) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (rows[i] + x));
+            __m256i b = _mm256_loadu_si256((const __m256i *) (rows[i + 1] + x));
+            __m256i w = _mm256_set1_epi32(weightPair(weights[i], weights[i + 1]));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        if (i < count) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (rows[i] + x));
+            __m256i w = _mm256_set1_epi32(weightPair(weights[i], 0));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, zero), w));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, zero), w));
+        }
+        lo = _mm256_srai_epi32(lo, ColumnShift);
+        hi = _mm256_srai_epi32(hi, ColumnShift);
+        // packing works per 128-bit lane, so gather quadwords 0 and 2
+        __m256i r = _mm256_packs_epi32(lo, hi);
+        r = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, r), 0x08);
+        _mm_storeu_si128((__m128i *) (dst + x / 4), _mm256_castsi256_si128(r));
+    }
+    filterColumnsSSE2(rows, weights, count, x / 4, width, dst);
+}
+
+#endif
+
+/******************************************************************************/
+
+static int selectedKernel = -1;
+
+bool YScaler::supported(Kernel kernel) {
+#ifdef SCALE_X86
+    __builtin_cpu_init();
+    if (kernel == SSE2)
+        return __builtin_cpu_supports("sse2");
+    if (kernel == AVX2)
+        return __builtin_cpu_supports("avx2");
+#endif
+    return kernel == Scalar;
+}
+
+YScaler::Kernel YScaler::kernel() {
+    if (selectedKernel < 0) {
+        selectedKernel = supported(AVX2) ? AVX2 :
+                         supported(SSE2) ? SSE2 : Scalar;
+    }
+    return Kernel(selectedKernel);
+}
+
+bool YScaler::select(Kernel kernel) {
+    if (supported(kernel)) {
+        selectedKernel = kernel;
+        return true;
+    }
+    return false;
+}
+
+const char* YScaler::name(Kernel kernel) {
+    return kernel == AVX2 ? "avx2" : kernel == SSE2 ? "sse2" : "scalar";
+}
+
+void YScaler::scale(const uint32_t* src, unsigned sw, unsigned sh,
+                    unsigned sstride,
+                    uint32_t* dst, unsigned dw, unsigned dh,
+                    unsigned dstride,
+                    Filter filter)
+{
+    if (sw == 0 || sh == 0 || dw == 0 || dh == 0)
+        return;
+
+    RowFilter filterRow = filterRowScalar;
+    ColumnFilter filterColumns = filterColumnsScalar;
+#ifdef SCALE_X86
+    if (kernel() >= SSE2) {
+        filterRow = filterRowSSE2;
+        filterColumns = kernel() == AVX2 ? filterColumnsAVX2 : filterColumnsSSE2;
+    }
+#endif
+
+    ScaleTaps horizontal(sw, dw, filter);
+    ScaleTaps vertical(sh, dh, filter);
+
+    const unsigned rowSize = 4 * dw;
+    const unsigned ringSize = unsigned(vertical.maxCount());
+    asmart<int16_t> ring(new int16_t[ringSize * rowSize]);
+    asmart<const int16_t*> rows(new const int16_t*[ringSize]);
+
+    unsigned next = 0;
+    for (unsigned y = 0; y < dh; ++y, dst += dstride) {
+        const unsigned first = vertical.first(y);
+        const int count = vertical.count(y);
+        for (; next < first + count; ++next) {
+            filterRow(horizontal, dw, src + size_t(next) * sstride,
+                      ring + (next % ringSize) * rowSize);
+        }
+        for (int i = 0; i < count; ++i)
+            rows[i] = ring + ((first + i) % ringSize) * rowSize;
+        filterColumns(rows, vertical.weights(y), count, 0, dw, dst);
+    }
+}
+
+// vim: set sw=4 ts=4 et:
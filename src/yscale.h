@@ -0,0 +1,42 @@
+#ifndef YSCALE_H
+#define YSCALE_H
+
+#include <stdint.h>
+
+/*
+ * Separable fixed-point resampling of 32-bit pixel buffers.
+ * The four bytes of a pixel are filtered independently,
+ * so any channel order like ARGB or ABGR will do.
+ */
+class YScaler {
+public:
+    enum Filter {
+        Box,            // area average, as used for icons and images
+        Bilinear,       // triangle filter, widened when shrinking
+        Lanczos,        // three lobed windowed sinc
+    };
+
+    enum Kernel {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // Scale sw x sh pixels with sstride pixels per row
+    // to dw x dh pixels with dstride pixels per row.
+    static void scale(const uint32_t* src, unsigned sw, unsigned sh,
+                      unsigned sstride,
+                      uint32_t* dst, unsigned dw, unsigned dh,
+                      unsigned dstride,
+                      Filter filter = Box);
+
+    // The best kernel for this processor is selected by default.
+    static Kernel kernel();
+    static bool supported(Kernel kernel);
+    static bool select(Kernel kernel);
+    static const char* name(Kernel kernel);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
@@ -0,0 +1,124 @@
+/*
+ * IceWM
+ *
+ * Starting programs.
+ */
+#include "config.h"
+#include "yspawn.h"
+#include "base.h"
+#include "debug.h"
+#include "intl.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_POSIX_SPAWNP
+#include <spawn.h>
+#endif
+
+extern char** environ;
+
+YSpawn::YSpawn() :
+    fNullInput(false),
+    fSession(false),
+    fMasked(false),
+    fOutput(-1),
+    fClose(-1)
+{
+    sigemptyset(&fMask);
+}
+
+YSpawn::~YSpawn() {
+}
+
+int YSpawn::spawn(const char* path, const char* const* args, bool search) {
+    const char* const none[] = { path, nullptr };
+    if (args == nullptr)
+        args = none;
+
+#if defined(HAVE_POSIX_SPAWNP) && defined(POSIX_SPAWN_SETSID)
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    if (posix_spawn_file_actions_init(&actions))
+        return forkExec(path, args, search);
+    if (posix_spawnattr_init(&attr)) {
+        posix_spawn_file_actions_destroy(&actions);
+        return forkExec(path, args, search);
+    }
+
+    short flags = 0;
+#ifdef POSIX_SPAWN_USEVFORK
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    if (fSession)
+        flags |= POSIX_SPAWN_SETSID;
+    if (fMasked) {
+        flags |= POSIX_SPAWN_SETSIGMASK;
+        posix_spawnattr_setsigmask(&attr, &fMask);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    if (fNullInput)
+        posix_spawn_file_actions_addopen(&actions, 0, "/dev/null",
+                                         O_RDONLY, 0);
+    if (fClose >= 0 && fClose != fOutput)
+        posix_spawn_file_actions_addclose(&actions, fClose);
+    if (fOutput >= 0 && fOutput != 1) {
+        posix_spawn_file_actions_adddup2(&actions, fOutput, 1);
+        posix_spawn_file_actions_addclose(&actions, fOutput);
+    }
+
+    char* const* argv = const_cast<char* const*>(args);
+    pid_t pid = -1;
+    int rc = search
+           ? posix_spawnp(&pid, path, &actions, &attr, argv, environ)
+           : posix_spawn(&pid, path, &actions, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (rc) {
+        errno = rc;
+        return -1;
+    }
+    return int(pid);
+#else
+    return forkExec(path, args, search);
+#endif
+}
+
+int YSpawn::forkExec(const char* path, const char* const* args, bool search) {
+    int pid = fork();
+    if (pid == 0) {
+        if (fMasked)
+            sigprocmask(SIG_SETMASK, &fMask, nullptr);
+        if (fSession)
+            setsid();
+        if (fNullInput) {
+            int devnull = open("/dev/null", O_RDONLY);
+            if (devnull > 0) {
+                dup2(devnull, 0);
+                close(devnull);
+            }
+        }
+        if (fClose >= 0 && fClose != fOutput)
+            close(fClose);
+        if (fOutput >= 0 && fOutput != 1) {
+            if (dup2(fOutput, 1) != 1 || close(fOutput))
+                fail("dup2!=1");
+        }
+
+        char* const* argv = const_cast<char* const*>(args);
+        if (search)
+            execvp(path, argv);
+        else
+            execv(path, argv);
+
+        fail(_("Failed to execute %s"), path);
+        _exit(99);
+    }
+    return pid;
+}
+
+// vim: set sw=4 ts=4 et:
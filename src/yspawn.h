@@ -0,0 +1,49 @@
+#ifndef YSPAWN_H
+#define YSPAWN_H
+
+#include <signal.h>
+
+/*
+ * Start a program without copying the address space of the caller,
+ * by posix_spawn where available, otherwise by fork. The setup of
+ * the child is described first and then applied by spawn, which
+ * returns the pid of the child, or -1 and sets errno on failure.
+ * With posix_spawn a program which can not be executed is reported
+ * as a failure, after fork the child exits with status 99.
+ */
+class YSpawn {
+public:
+    YSpawn();
+    ~YSpawn();
+
+    // Read standard input from /dev/null.
+    void nullInput() { fNullInput = true; }
+    // Write standard output to fd.
+    void output(int fd) { fOutput = fd; }
+    // Close fd in the child, like the read end of the output pipe.
+    void closeFile(int fd) { fClose = fd; }
+    // Start a new session, detached from the terminal.
+    void newSession() { fSession = true; }
+    // Signals to block in the child.
+    void signalMask(const sigset_t& mask) { fMask = mask; fMasked = true; }
+
+    // Start path with args, and search PATH if path has no slash.
+    int spawn(const char* path, const char* const* args, bool search);
+
+private:
+    bool fNullInput;
+    bool fSession;
+    bool fMasked;
+    int fOutput;
+    int fClose;
+    sigset_t fMask;
+
+    int forkExec(const char* path, const char* const* args, bool search);
+
+    YSpawn(const YSpawn&);
+    YSpawn& operator=(const YSpawn&);
+};
+
+#endif
+
+// vim: set sw=4 ts=4 et:
@@ -18,6 +18,7 @@
 #include "ytimer.h"
 #include "ypopup.h"
 #include "yxcontext.h"
+#include "yiconloader.h"
 #include <typeinfo>
 
 #ifdef XINERAMA
@@ -105,6 +106,12 @@ XButtonEvent YWindow::fClickEvent;
 bool YWindow::fClickDrag;
 unsigned int YWindow::fClickButton = 0;
 unsigned int YWindow::fClickButtonDown = 0;
+YArray<YWindow*> YWindow::fExposeQueue;
+unsigned long YWindow::fExposeEvents;
+unsigned long YWindow::fExposePaints;
+YArray<YWindow*> YWindow::fInvalidQueue;
+unsigned long YWindow::fInvalidations;
+unsigned long YWindow::fInvalidPaints;
 
 unsigned long YWindow::lastEnterNotifySerial; // credits to ahwm
 unsigned long YWindow::getLastEnterNotifySerial() {
@@ -164,9 +171,20 @@ YWindow::~YWindow() {
     }
     if (fClickWindow == this)
         fClickWindow = nullptr;
+    if (flags & wfExposed) {
+        YWindow* self = this;
+        findRemove(fExposeQueue, self);
+    }
+    if (flags & wfInvalid) {
+        YWindow* self = this;
+        findRemove(fInvalidQueue, self);
+    }
+    if (flags & wfIconWait)
+        YIconLoader::forget(this);
     if (fGraphics) {
         delete fGraphics; fGraphics = nullptr;
     }
+    GraphicsBuffer::detach(this);
     if (flags & wfCreated)
         destroy();
 }
@@ -272,6 +290,43 @@ void YWindow::repaintFocus() {
     repaint();
 }
 
+void YWindow::invalidate() {
+    invalidateRect(YRect(0, 0, width(), height()));
+}
+
+// Defer a repaint until the current batch of events has been handled,
+// such that repeated state changes result in a single repaint.
+void YWindow::invalidateRect(const YRect& r) {
+    ++fInvalidations;
+    if (flags & wfInvalid) {
+        fInvalid += r;
+    } else {
+        fInvalid = r;
+        flags |= wfInvalid;
+        YWindow* self = this;
+        fInvalidQueue.append(self);
+    }
+}
+
+bool YWindow::flushInvalid() {
+    const bool painting = fInvalidQueue.nonempty();
+    for (int n = fInvalidQueue.getCount(); 0 < n--; ) {
+        if (fInvalidQueue.isEmpty())
+            break;
+        YWindow* w = fInvalidQueue[0];
+        fInvalidQueue.remove(0);
+        w->flags &= unsigned(~wfInvalid);
+        if (w->destroyed() == false) {
+            ++fInvalidPaints;
+            if (w->fInvalid.contains(YRect(0, 0, w->width(), w->height())))
+                w->repaint();
+            else
+                w->repaintRect(w->fInvalid);
+        }
+    }
+    return painting;
+}
+
 bool YWindow::getWindowAttributes(XWindowAttributes* attr) {
     if (fHandle == None)
         return false;
@@ -493,6 +548,12 @@ void YWindow::reparent(YWindow *parent, int x, int y) {
 void YWindow::show() {
     if (!(flags & (wfVisible | wfDestroyed))) {
         flags |= wfVisible;
+        if (flags & wfRepaint) {
+            flags &= unsigned(~wfRepaint);
+            repaint();
+        }
+        for (YWindow* w = firstWindow(); w; w = w->nextWindow())
+            w->ancestorShown();
         if (!(flags & wfNullSize))
             XMapWindow(xapp->display(), handle());
     }
@@ -505,9 +566,36 @@ void YWindow::hide() {
             addIgnoreUnmap(handle());
             XUnmapWindow(xapp->display(), handle());
         }
+        ancestorHidden();
     }
 }
 
+// Repaint the descendants which gave up their buffers when hidden.
+void YWindow::ancestorShown() {
+    if ((flags & (wfVisible | wfDestroyed)) == wfVisible) {
+        if (flags & wfRepaint) {
+            flags &= unsigned(~wfRepaint);
+            repaint();
+        }
+        for (YWindow* w = firstWindow(); w; w = w->nextWindow())
+            w->ancestorShown();
+    }
+}
+
+void YWindow::ancestorHidden() {
+    releaseBuffers();
+    for (YWindow* w = firstWindow(); w; w = w->nextWindow())
+        if (w->visible())
+            w->ancestorHidden();
+}
+
+bool YWindow::viewable() const {
+    for (const YWindow* w = this; w && w->parent(); w = w->parent())
+        if (w->visible() == false)
+            return false;
+    return true;
+}
+
 void YWindow::setDestroyed() {
     flags |= wfDestroyed;
 }
@@ -757,7 +845,6 @@ void YWindow::handleEvent(const XEvent &event) {
     }
 }
 
-/// TODO #warning "implement expose compression"
 void YWindow::paintExpose(int ex, int ey, int ew, int eh) {
     if (ex < 0) {
         ew += ex;
@@ -783,12 +870,90 @@ void YWindow::paintExpose(int ex, int ey, int ew, int eh) {
     }
 }
 
+// Accumulate exposed areas until the last event of a series (count == 0)
+// or until the event queue is drained, then paint them all at once.
+void YWindow::addExpose(int ex, int ey, int ew, int eh) {
+    const int maxRects = 16;
+
+    ++fExposeEvents;
+    if (ex < 0) {
+        ew += ex;
+        ex = 0;
+    }
+    if (ey < 0) {
+        eh += ey;
+        ey = 0;
+    }
+    ew = min(ew, int(width()) - ex);
+    eh = min(eh, int(height()) - ey);
+    if (ew <= 0 || eh <= 0)
+        return;
+
+    YRect rect(ex, ey, unsigned(ew), unsigned(eh));
+    for (int i = fExposed.getCount(); --i >= 0; ) {
+        YRect old(fExposed[i]);
+        if (old.contains(rect))
+            return;
+        if (rect.contains(old))
+            fExposed.remove(i);
+    }
+    if (notbit(flags, wfExposed)) {
+        YWindow* self = this;
+        fExposeQueue.append(self);
+        flags |= wfExposed;
+    }
+    if (fExposed.getCount() >= maxRects) {
+        for (const XRectangle& r : fExposed)
+            rect += YRect(r);
+        fExposed.clear();
+    }
+    XRectangle r = {
+        short(rect.x()),
+        short(rect.y()),
+        static_cast<unsigned short>(rect.width()),
+        static_cast<unsigned short>(rect.height()),
+    };
+    fExposed.append(r);
+}
+
+void YWindow::paintExposures() {
+    if (flags & wfExposed) {
+        YWindow* self = this;
+        findRemove(fExposeQueue, self);
+        flags &= unsigned(~wfExposed);
+    }
+    if (fExposed.isEmpty())
+        return;
+
+    YArray<XRectangle> rects;
+    rects.swap(fExposed);
+    YRect bounds(rects[0]);
+    for (const XRectangle& r : rects)
+        bounds += YRect(r);
+
+    ++fExposePaints;
+    Graphics& g(getGraphics());
+    g.setClipRectangles(rects.getItemPtr(0), rects.getCount());
+    paint(g, bounds);
+    g.resetClip();
+}
+
+void YWindow::flushExposures() {
+    while (fExposeQueue.nonempty()) {
+        fExposeQueue[0]->paintExposures();
+    }
+}
+
 void YWindow::handleExpose(const XExposeEvent &expose) {
-    paintExpose(expose.x, expose.y, expose.width, expose.height);
+    addExpose(expose.x, expose.y, expose.width, expose.height);
+    if (expose.count == 0)
+        paintExposures();
 }
 
 void YWindow::handleGraphicsExpose(const XGraphicsExposeEvent &expose) {
-    paintExpose(expose.x, expose.y, expose.width, expose.height);
+    addExpose(expose.x, expose.y, expose.width, expose.height);
+    if (expose.count == 0)
+        paintExposures();
 }
 
 void YWindow::handleConfigure(const XConfigureEvent &configure) {
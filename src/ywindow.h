@@ -59,6 +59,14 @@ public:
 
     virtual void repaint();
     virtual void repaintFocus();
+    // Give up paint buffers, because this window or an ancestor hides.
+    virtual void releaseBuffers() { }
+    virtual void repaintRect(const YRect& r) { repaint(); }
+
+    void invalidate();
+    void invalidateRect(const YRect& r);
+    static bool flushInvalid();
+    static bool invalidPending() { return fInvalidQueue.nonempty(); }
 
     void readAttributes();
     void reparent(YWindow *parent, int x, int y);
@@ -146,6 +154,11 @@ public:
     YWindow *window() { return this; }
 
     void paintExpose(int ex, int ey, int ew, int eh);
+    static void flushExposures();
+    static unsigned long exposeEvents() { return fExposeEvents; }
+    static unsigned long exposePaints() { return fExposePaints; }
+    static unsigned long invalidations() { return fInvalidations; }
+    static unsigned long invalidPaints() { return fInvalidPaints; }
 
     Graphics& getGraphics();
     virtual ref<YImage> getGradient() {
@@ -162,10 +175,15 @@ public:
     YDimension dimension() const { return YDimension(fWidth, fHeight); }
 
     bool visible() const { return (flags & wfVisible); }
+    // Whether this window and all its ancestors are visible.
+    bool viewable() const;
     bool created() const { return (flags & wfCreated); }
     bool adopted() const { return (flags & wfAdopted); }
     bool focused() const { return (flags & wfFocused); }
     bool destroyed() const { return (flags & wfDestroyed); }
+    void repaintOnShow() { flags |= wfRepaint; }
+    // An icon for this window is loaded in the background.
+    void waitForIcon() { flags |= wfIconWait; }
     void setDestroyed();
     bool testDestroyed();
 
@@ -258,6 +276,10 @@ private:
         wfToplevel  = 1 << 4,
         wfNullSize  = 1 << 5,
         wfFocused   = 1 << 6,
+        wfInvalid   = 1 << 7,
+        wfRepaint   = 1 << 8,
+        wfExposed   = 1 << 9,
+        wfIconWait  = 1 << 10,
     };
 
     Window create();
@@ -269,6 +291,11 @@ private:
 
     bool nullGeometry();
 
+    void ancestorShown();
+    void ancestorHidden();
+    void addExpose(int ex, int ey, int ew, int eh);
+    void paintExposures();
+
     unsigned fDepth;
     Visual *fVisual;
     Colormap fColormap;
@@ -284,6 +311,8 @@ private:
     YCursor fPointer;
     int unmapCount;
     Graphics *fGraphics;
+    YArray<XRectangle> fExposed;
+    YRect fInvalid;
     long fEventMask;
     int fWinGravity, fBitGravity;
 
@@ -308,6 +337,12 @@ private:
     static void updateEnterNotifySerial(const XEvent& event);
 
     static YAutoScroll *fAutoScroll;
+    static YArray<YWindow*> fExposeQueue;
+    static unsigned long fExposeEvents;
+    static unsigned long fExposePaints;
+    static YArray<YWindow*> fInvalidQueue;
+    static unsigned long fInvalidations;
+    static unsigned long fInvalidPaints;
 
     void addIgnoreUnmap(Window w);
     bool ignoreUnmap(Window w);
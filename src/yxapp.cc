@@ -1118,6 +1118,19 @@ void YXApplication::initExtensions(Display* dpy) {
 }
 
 YXApplication::~YXApplication() {
+    if (YTrace::traces("paint")) {
+        unsigned long events = YWindow::exposeEvents();
+        unsigned long paints = YWindow::exposePaints();
+        tlog("paint: %lu expose events, %lu paints, %lu saved",
+             events, paints, events - min(events, paints));
+        unsigned long invalid = YWindow::invalidations();
+        unsigned long repaint = YWindow::invalidPaints();
+        tlog("paint: %lu invalidations, %lu repaints, %lu saved",
+             invalid, repaint, invalid - min(invalid, repaint));
+        tlog("paint: %lu buffer pixmaps created, %lu reused",
+             GraphicsBuffer::pixmapsCreated(),
+             GraphicsBuffer::pixmapsReused());
+    }
     if (fColormap32 != CopyFromParent)
         XFreeColormap(xapp->display(), fColormap32);
 
@@ -1189,11 +1202,18 @@ bool YXApplication::handleXEvents() {
         }
         XFlush(display());
     }
+    if (retrieved > 0) {
+        YWindow::flushExposures();
+        XFlush(display());
+    }
     return retrieved > 0;
 }
 
 bool YXApplication::handleIdle() {
-    return handleXEvents();
+    bool busy = handleXEvents();
+    if (YWindow::flushInvalid())
+        XFlush(display());
+    return busy;
 }
 
 void YXApplication::handleWindowEvent(Window xwindow, XEvent &xev) {
@@ -12,17 +12,25 @@
 #endif
 
 #include "yimage.h"
+#include "yscale.h"
 #include "yxapp.h"
 #include "ypointer.h"
 #include "intl.h"
 
 #include <X11/xpm.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 
 #ifdef CONFIG_LIBJPEG
 #include <jpeglib.h>
 #include <setjmp.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define ATH 10  /* highest alpha threshold that can show anti-aliased lines */
 
 struct Verbose {
@@ -64,16 +72,29 @@ public:
     static ref<YImage> loadxbm(upath filename);
     static ref<YImage> loadxpm(upath filename);
     static ref<YImage> loadxpm2(upath filename, int& status);
+    // The decoders return ARGB pixels in malloc memory, or null.
+    // They make no requests to the X server.
 #ifdef CONFIG_LIBPNG
-    static ref<YImage> loadpng(upath filename);
-    static void pngload(ref<YImage>& image, FILE* f,
-                        png_structp png_ptr,
-                        png_infop info_ptr);
+    static ref<YImage> loadpng(upath filename, unsigned hw, unsigned hh);
+    static uint32_t* decodepng(upath filename, unsigned hw, unsigned hh,
+                               unsigned* width, unsigned* height);
+    static uint32_t* pngload(FILE* f,
+                             png_structp png_ptr,
+                             png_infop info_ptr,
+                             unsigned hw, unsigned hh,
+                             unsigned* width, unsigned* height);
     bool savepng(upath filename, const char** error);
 #endif
 #ifdef CONFIG_LIBJPEG
-    static ref<YImage> loadjpg(upath filename);
+    static ref<YImage> loadjpg(upath filename, unsigned hw, unsigned hh);
+    static uint32_t* decodejpg(upath filename, unsigned hw, unsigned hh,
+                               unsigned* width, unsigned* height);
 #endif
+    static ref<YImage> fromPixels(uint32_t* pixels,
+                                  unsigned width, unsigned height);
+    static void stretchAlpha(uint32_t* pixels, unsigned count);
+    static unsigned reduction(unsigned width, unsigned height,
+                              unsigned hw, unsigned hh);
     static ref<YImage> combine(XImage *xdraw, XImage *xmask);
     static mstring detectImageType(upath filename);
 
@@ -83,11 +104,21 @@ public:
     ref<YImage> downscale(unsigned width, unsigned height);
     virtual ref<YImage> subimage(int x, int y, unsigned width, unsigned height);
     virtual void save(upath filename);
+    virtual bool readPixels(uint32_t* argb) const;
 
     unsigned long getPixel(unsigned x, unsigned y) const {
         return XGetPixel(fImage, int(x), int(y));
     }
 
+    void getPixels(uint32_t* pixels, bool bitmap) const;
+    static void putPixels(XImage* ximage, const uint32_t* pixels);
+    static uint32_t* nativePixels(XImage* ximage);
+    static bool swappedPixels(XImage* ximage);
+    static void getRow(XImage* ximage, unsigned y, uint32_t* row);
+    static void putRow(XImage* ximage, unsigned y, const uint32_t* row);
+    static bool directBits(XImage* ximage);
+    static void putMaskRow(XImage* xmask, unsigned y, const uint32_t* row);
+
     static XImage* createImage(unsigned width, unsigned height, unsigned depth) {
         Visual* visual = xapp->visualForDepth(depth);
         XImage* ximage = XCreateImage(xapp->display(), visual, depth,
@@ -136,7 +167,22 @@ bool YImage::supportsDepth(unsigned depth) {
     return depth == 32 || depth == xapp->depth();
 }
 
-ref<YImage> YImage::load(upath filename)
+bool YImage::loadsConcurrently(upath filename) {
+    // PNG and JPEG are decoded into plain pixel buffers
+    // without requests to the X server or shared state.
+    mstring ext(filename.getExtension().lower());
+#ifdef CONFIG_LIBPNG
+    if (ext == ".png")
+        return true;
+#endif
+#ifdef CONFIG_LIBJPEG
+    if (ext == ".jpg" || ext == ".jpeg")
+        return true;
+#endif
+    return false;
+}
+
+ref<YImage> YImage::load(upath filename, unsigned width, unsigned height)
 {
     ref<YImage> image;
     mstring ext(filename.getExtension().lower());
@@ -151,7 +197,7 @@ ref<YImage> YImage::load(upath filename)
         image = YXImage::loadxpm(filename);
     else if (ext == ".png") {
 #ifdef CONFIG_LIBPNG
-        image = YXImage::loadpng(filename);
+        image = YXImage::loadpng(filename, width, height);
 #else
         if (ONCE)
             warn(_("Support for PNG images was not enabled"));
@@ -159,7 +205,7 @@ ref<YImage> YImage::load(upath filename)
     }
     else if (ext == ".jpg" || ext == ".jpeg") {
 #ifdef CONFIG_LIBJPEG
-        image = YXImage::loadjpg(filename);
+        image = YXImage::loadjpg(filename, width, height);
 #else
         if (ONCE)
             warn(_("Support for JPEG images was not enabled"));
@@ -300,10 +346,45 @@ ref<YImage> YXImage::loadxpm2(upath filename, int& status)
     return image;
 }
 
-#ifdef CONFIG_LIBPNG
-ref<YImage> YXImage::loadpng(upath filename)
+// The largest power of two up to 8 by which an image can be
+// reduced while it still covers a hint of hw x hh pixels.
+unsigned YXImage::reduction(unsigned width, unsigned height,
+                            unsigned hw, unsigned hh)
+{
+    unsigned d = 1;
+    if (hw || hh) {
+        while (d < 8 &&
+               (width + 2 * d - 1) / (2 * d) >= hw &&
+               (height + 2 * d - 1) / (2 * d) >= hh)
+            d *= 2;
+    }
+    return d;
+}
+
+// An image from decoded pixels, which are freed.
+ref<YImage> YXImage::fromPixels(uint32_t* pixels,
+                                unsigned width, unsigned height)
 {
     ref<YImage> image;
+    if (pixels) {
+        image = createFromPixels(pixels, width, height);
+        free(pixels);
+    }
+    return image;
+}
+
+#ifdef CONFIG_LIBPNG
+ref<YImage> YXImage::loadpng(upath filename, unsigned hw, unsigned hh)
+{
+    unsigned width = 0, height = 0;
+    uint32_t* pixels = decodepng(filename, hw, hh, &width, &height);
+    return fromPixels(pixels, width, height);
+}
+
+uint32_t* YXImage::decodepng(upath filename, unsigned hw, unsigned hh,
+                             unsigned* width, unsigned* height)
+{
+    uint32_t* pixels = nullptr;
     png_structp png_ptr;
     png_infop info_ptr;
     png_byte buf[8];
@@ -331,7 +412,7 @@ ref<YImage> YXImage::loadpng(upath filename)
         goto noinfo;
     }
 
-    pngload(image, f, png_ptr, info_ptr);
+    pixels = pngload(f, png_ptr, info_ptr, hw, hh, width, height);
 
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
     goto noread;
@@ -340,18 +421,63 @@ ref<YImage> YXImage::loadpng(upath filename)
   noread:
     fclose(f);
   nofile:
-    return image;
+    return pixels;
 }
 
-void YXImage::pngload(ref<YImage>& image, FILE* f,
-                      png_structp png_ptr,
-                      png_infop info_ptr)
+// Convert one row of 8-bit PNG samples to ARGB pixels.
+static void pngRow(const png_byte* p, int channels,
+                   unsigned width, uint32_t* row)
 {
+    for (unsigned i = 0; i < width; i++, p += channels) {
+        uint32_t A = 255, R = 0, G = 0, B = 0;
+        switch (channels) {
+            case 1:
+                R = G = B = p[0];
+                break;
+            case 2:
+                R = G = B = p[0];
+                A = p[1];
+                break;
+            case 3:
+                R = p[0];
+                G = p[1];
+                B = p[2];
+                break;
+            case 4:
+                R = p[0];
+                G = p[1];
+                B = p[2];
+                A = p[3];
+                break;
+            default:
+                A = 0;
+                break;
+        }
+        row[i] = (A << 24) | (R << 16) | (G << 8) | (B << 0);
+    }
+}
+
+uint32_t* YXImage::pngload(FILE* f,
+                           png_structp png_ptr,
+                           png_infop info_ptr,
+                           unsigned hw, unsigned hh,
+                           unsigned* pwidth, unsigned* pheight)
+{
+    // Rows are decoded one at a time and reduced by averaging
+    // blocks of d x d pixels, unless the image is interlaced.
+    png_byte* volatile png_pixels = nullptr;
+    png_byte** volatile row_pointers = nullptr;
+    uint32_t* volatile line = nullptr;
+    uint32_t* volatile pixels = nullptr;
+    uint32_t* result = nullptr;
+
     if (setjmp(png_jmpbuf(png_ptr))) {
         tlog("ERROR: longjump from setjump\n");
+        if (pixels)
+            free(pixels);
     } else {
         png_uint_32 width, height, row_bytes, i, j;
-        int bit_depth, color_type, channels;
+        int bit_depth, color_type, channels, passes;
 
         png_init_io(png_ptr, f);
         png_set_sig_bytes(png_ptr, 8);
@@ -372,6 +498,7 @@ void YXImage::pngload(ref<YImage>& image, FILE* f,
         if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
             png_set_gray_to_rgb(png_ptr);
         }
+        passes = png_set_interlace_handling(png_ptr);
         png_read_update_info(png_ptr, info_ptr);
         png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, &color_type, NULL, NULL, NULL);
         if (color_type == PNG_COLOR_TYPE_GRAY)
@@ -385,54 +512,80 @@ void YXImage::pngload(ref<YImage>& image, FILE* f,
         else
             channels = 0;
         row_bytes = png_get_rowbytes(png_ptr, info_ptr);
-        png_byte *png_pixels = static_cast<png_byte *>(
+        if (passes > 1) {
+            png_pixels = static_cast<png_byte *>(
                   calloc(row_bytes * height, sizeof(*png_pixels)));
-        png_byte **row_pointers = static_cast<png_byte **>(
+            row_pointers = static_cast<png_byte **>(
                    calloc(height, sizeof(*row_pointers)));
-        for (i = 0; i < height; i++)
-            row_pointers[i] = png_pixels + i * row_bytes;
-        png_read_image(png_ptr, row_pointers);
-        png_read_end(png_ptr, info_ptr);
-        XImage *ximage = createImage(width, height, 32U);
-        if (ximage) {
-            unsigned long pixel, A = 0, R = 0, G = 0, B = 0;
-            png_byte *p = png_pixels;
+            if (png_pixels && row_pointers) {
+                for (j = 0; j < height; j++)
+                    row_pointers[j] = png_pixels + j * row_bytes;
+                png_read_image(png_ptr, row_pointers);
+            }
+        } else {
+            png_pixels = static_cast<png_byte *>(
+                  calloc(row_bytes, sizeof(*png_pixels)));
+        }
+
+        const unsigned d = reduction(width, height, hw, hh);
+        const unsigned nw = (width + d - 1) / d;
+        const unsigned nh = (height + d - 1) / d;
+        if (d > 1 && verbose)
+            tlog("png %ux%u reduced by %u to %ux%u",
+                 unsigned(width), unsigned(height), d, nw, nh);
+
+        line = static_cast<uint32_t *>(
+               calloc(width + 4 * nw, sizeof(*line)));
+        if (png_pixels && (passes == 1 || row_pointers) && line)
+            pixels = static_cast<uint32_t *>(
+                     malloc(size_t(nw) * nh * sizeof(*pixels)));
+        if (pixels) {
+            uint32_t* sums = line + width;
             for (j = 0; j < height; j++) {
-                for (i = 0; i < width; i++, p += channels) {
-                    switch(color_type) {
-                        case PNG_COLOR_TYPE_GRAY:
-                            R = G = B = p[0];
-                            A = 255;
-                            break;
-                        case PNG_COLOR_TYPE_GRAY_ALPHA:
-                            R = G = B = p[0];
-                            A = p[1];
-                            break;
-                        case PNG_COLOR_TYPE_RGB:
-                            R = p[0];
-                            G = p[1];
-                            B = p[2];
-                            A = 255;
-                            break;
-                        case PNG_COLOR_TYPE_RGB_ALPHA:
-                            R = p[0];
-                            G = p[1];
-                            B = p[2];
-                            A = p[3];
-                            break;
-                    }
-                    pixel = (A << 24)|(R <<16)|(G<<8)|(B<<0);
-                    XPutPixel(ximage, i, j, pixel);
+                png_byte* p = png_pixels;
+                if (passes > 1)
+                    p = row_pointers[j];
+                else
+                    png_read_row(png_ptr, p, NULL);
+                if (d == 1) {
+                    pngRow(p, channels, width, pixels + size_t(j) * nw);
+                    continue;
+                }
+                pngRow(p, channels, width, line);
+
+                for (i = 0; i < width; i++) {
+                    uint32_t* sum = sums + 4 * (i / d);
+                    for (int c = 0; c < 4; c++)
+                        sum[c] += (line[i] >> (8 * c)) & 0xFF;
+                }
+                if ((j + 1) % d && j + 1 < height)
+                    continue;
+
+                const unsigned rows = j % d + 1;
+                for (i = 0; i < nw; i++) {
+                    uint32_t* sum = sums + 4 * i;
+                    unsigned count = rows * min(d, unsigned(width - i * d));
+                    uint32_t pixel = 0;
+                    for (int c = 0; c < 4; c++)
+                        pixel |= ((sum[c] + count / 2) / count) << (8 * c);
+                    pixels[size_t(j / d) * nw + i] = pixel;
                 }
+                memset(sums, 0, 4 * nw * sizeof(*sums));
             }
+            png_read_end(png_ptr, info_ptr);
 
-            image.init(new YXImage(ximage));
+            result = pixels;
+            *pwidth = nw;
+            *pheight = nh;
         }
-        if (png_pixels)
-            free(png_pixels);
-        if (row_pointers)
-            free(row_pointers);
     }
+    if (png_pixels)
+        free(png_pixels);
+    if (row_pointers)
+        free(row_pointers);
+    if (line)
+        free(line);
+    return result;
 }
 #endif
 
@@ -526,17 +679,24 @@ static void my_jpeg_error_exit(j_common_ptr cinfo) {
     longjmp(myjmp->setjmp_buffer, 1);
 }
 
-ref<YImage> YXImage::loadjpg(upath filename)
+ref<YImage> YXImage::loadjpg(upath filename, unsigned hw, unsigned hh)
 {
-    ref<YImage> yximage;
+    unsigned width = 0, height = 0;
+    uint32_t* pixels = decodejpg(filename, hw, hh, &width, &height);
+    return fromPixels(pixels, width, height);
+}
+
+uint32_t* YXImage::decodejpg(upath filename, unsigned hw, unsigned hh,
+                             unsigned* pwidth, unsigned* pheight)
+{
+    uint32_t* volatile pixels = nullptr;
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_jmp jerr;
     JSAMPARRAY buffer;
-    int row_stride;
     FILE* infile = filename.fopen("rb");
     if (infile == 0) {
         fail("could not open %s", filename.string());
-        return yximage;
+        return nullptr;
     }
 
     cinfo.err = jpeg_std_error(&jerr);
@@ -544,7 +704,9 @@ ref<YImage> YXImage::loadjpg(upath filename)
     if (setjmp(jerr.setjmp_buffer)) {
         jpeg_destroy_decompress(&cinfo);
         fclose(infile);
-        return yximage;
+        if (pixels)
+            free(pixels);
+        return nullptr;
     }
 
     jpeg_create_decompress(&cinfo);
@@ -562,224 +724,472 @@ ref<YImage> YXImage::loadjpg(upath filename)
                     cinfo.out_color_space);
             jpeg_destroy_decompress(&cinfo);
             fclose(infile);
-            return null;
+            return nullptr;
+    }
+    // Let the IDCT decode at 1/2, 1/4 or 1/8 of the size.
+    unsigned reduce = reduction(cinfo.image_width, cinfo.image_height, hw, hh);
+    if (reduce > 1) {
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = reduce;
+        if (verbose)
+            tlog("jpeg %ux%u reduced by %u",
+                 unsigned(cinfo.image_width), unsigned(cinfo.image_height),
+                 reduce);
     }
     (void) jpeg_start_decompress(&cinfo);
-    row_stride = cinfo.output_width * cinfo.output_components;
+    const int row_stride = cinfo.output_width * cinfo.output_components;
     buffer = (*cinfo.mem->alloc_sarray)
                 ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
 
-    const int width = int(cinfo.output_width);
-    const int height = int(cinfo.output_height);
-    XImage* ximage = createImage(width, height, 32U);
-    if (ximage) {
-        const bool bigendian = ximage->byte_order == MSBFirst;
+    const unsigned width = cinfo.output_width;
+    const unsigned height = cinfo.output_height;
+    pixels = static_cast<uint32_t *>(
+             malloc(size_t(width) * height * sizeof(uint32_t)));
+    if (pixels) {
         const int colorspace = cinfo.out_color_space;
         const int bpp = cinfo.num_components;
 
-        for (int line; (line = int(cinfo.output_scanline)) < height; ) {
+        for (unsigned line; (line = cinfo.output_scanline) < height; ) {
             (void) jpeg_read_scanlines(&cinfo, buffer, 1);
-            unsigned char* buf = (unsigned char *) buffer[0];
-            unsigned char* dst = (unsigned char *) ximage->data
-                               + line * ximage->bytes_per_line;
-            if (bigendian) {
-                if (colorspace == JCS_RGB) {
-                    for (int i = 0; i < width; ++i, buf += bpp, dst += 4) {
-                        dst[0] = 0xFF;
-                        dst[1] = buf[0];
-                        dst[2] = buf[1];
-                        dst[3] = buf[2];
-                    }
-                }
-#ifdef JCS_EXTENSIONS
-                else if (colorspace == JCS_EXT_RGBA) {
-                    for (int i = 0; i < width; ++i, buf += bpp, dst += 4) {
-                        dst[0] = buf[3];
-                        dst[1] = buf[0];
-                        dst[2] = buf[1];
-                        dst[3] = buf[2];
-                    }
-                }
-#endif
-                else if (colorspace == JCS_GRAYSCALE) {
-                    for (int i = 0; i < width; ++i, buf += bpp, dst += 4) {
-                        dst[0] = 0xFF;
-                        dst[1] = buf[0];
-                        dst[2] = buf[0];
-                        dst[3] = buf[0];
-                    }
-                }
-            } else {
-                if (colorspace == JCS_RGB) {
-                    for (int i = 0; i < width; ++i, buf += bpp, dst += 4) {
-                        dst[3] = 0xFF;
-                        dst[2] = buf[0];
-                        dst[1] = buf[1];
-                        dst[0] = buf[2];
-                    }
-                }
+            const unsigned char* buf = (const unsigned char *) buffer[0];
+            uint32_t* dst = pixels + size_t(line) * width;
+            if (colorspace == JCS_RGB) {
+                for (unsigned i = 0; i < width; ++i, buf += bpp)
+                    dst[i] = 0xFF000000 | (buf[0] << 16)
+                           | (buf[1] << 8) | buf[2];
+            }
 #ifdef JCS_EXTENSIONS
-                else if (colorspace == JCS_EXT_RGBA) {
-                    for (int i = 0; i < width; ++i, buf += bpp, dst += 4) {
-                        dst[3] = buf[3];
-                        dst[2] = buf[0];
-                        dst[1] = buf[1];
-                        dst[0] = buf[2];
-                    }
-                }
+            else if (colorspace == JCS_EXT_RGBA) {
+                for (unsigned i = 0; i < width; ++i, buf += bpp)
+                    dst[i] = (uint32_t(buf[3]) << 24) | (buf[0] << 16)
+                           | (buf[1] << 8) | buf[2];
+            }
 #endif
-                else if (colorspace == JCS_GRAYSCALE) {
-                    for (int i = 0; i < width; ++i, buf += bpp, dst += 4) {
-                        dst[3] = 0xFF;
-                        dst[2] = buf[0];
-                        dst[1] = buf[0];
-                        dst[0] = buf[0];
-                    }
-                }
+            else if (colorspace == JCS_GRAYSCALE) {
+                for (unsigned i = 0; i < width; ++i, buf += bpp)
+                    dst[i] = 0xFF000000 | (buf[0] << 16)
+                           | (buf[0] << 8) | buf[0];
             }
         }
-        yximage.init(new YXImage(ximage));
+        *pwidth = width;
+        *pheight = height;
     }
 
     (void) jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
     fclose(infile);
-    return yximage;
+    return pixels;
 }
 #endif
 
-ref<YImage> YXImage::upscale(unsigned nw, unsigned nh)
+#ifndef X_ShmAttach
+#define X_ShmAttach 1
+#endif
+
+// One shared memory segment for large uploads to a local server.
+// It is attached once and reused, and it grows when an image needs
+// more room. A segment above 8 MiB is given up after its put, so a
+// large background does not keep its memory for the session.
+// Before it is overwritten the server must have executed the
+// previous put, which is usually known without a sync.
+class YShmSegment {
+public:
+    YShmSegment();
+
+    // A shared memory image with a copy of source, or null.
+    XImage* image(XImage* source);
+    // Called after the put of the current image.
+    void pending();
+
+    static bool wanted(XImage* ximage);
+
+private:
+    enum { KeepSize = 8 << 20 };
+
+    XShmSegmentInfo fInfo;
+    size_t fSize;
+    unsigned long fPending;
+
+    bool reserve(size_t size);
+    void release();
+
+    static bool fFailed;
+    static int fMajor;
+    static XErrorHandler fOldHandler;
+    static int attachError(Display* display, XErrorEvent* xev);
+};
+
+bool YShmSegment::fFailed;
+int YShmSegment::fMajor;
+XErrorHandler YShmSegment::fOldHandler;
+
+static YShmSegment shmSegment;
+
+int YShmSegment::attachError(Display* display, XErrorEvent* xev) {
+    if (xev->request_code == fMajor && xev->minor_code == X_ShmAttach) {
+        fFailed = true;
+        return Success;
+    }
+    return fOldHandler ? fOldHandler(display, xev) : Success;
+}
+
+// Images from 256 KiB on are worth the copy into shared memory.
+bool YShmSegment::wanted(XImage* ximage) {
+    if (fFailed || !xshm.supported || ximage->format != ZPixmap)
+        return false;
+    if (size_t(ximage->bytes_per_line) * ximage->height < 256 * 1024)
+        return false;
+    const char* name = DisplayString(xapp->display());
+    return name[0] == ':' || strncmp(name, "unix:", 5) == 0;
+}
+
+YShmSegment::YShmSegment():
+    fSize(0),
+    fPending(0)
 {
-    ref<YImage> image;
-    XImage *ximage = 0;
-    double *chanls = 0;
-    double *counts = 0;
-    double *colors = 0;
+    memset(&fInfo, 0, sizeof fInfo);
+}
 
-    if (!valid()) {
-        tlog("ERROR: not a valid YXImage\n");
-        goto error;
+void YShmSegment::release() {
+    if (fSize) {
+        // The server completes a put before it handles the detach.
+        XShmDetach(xapp->display(), &fInfo);
+        shmdt(fInfo.shmaddr);
+        memset(&fInfo, 0, sizeof fInfo);
+        fSize = 0;
     }
-    {
-        unsigned w = fImage->width;
-        unsigned h = fImage->height;
-        bool has_alpha = hasAlpha();
+}
 
-        // tlog("upscale from %ux%ux%u to %ux%u\n", w, h, d, nw, nh);
-        ximage = createImage(nw, nh, fImage->depth);
-        if (ximage == 0) {
-            goto error;
+void YShmSegment::pending() {
+    if (fSize > size_t(KeepSize))
+        release();
+    else
+        fPending = NextRequest(xapp->display()) - 1;
+}
+
+bool YShmSegment::reserve(size_t size) {
+    if (size <= fSize)
+        return true;
+
+    Display* display = xapp->display();
+    release();
+    size = max(size, size_t(1024 * 1024));
+
+    fInfo.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (fInfo.shmid == -1)
+        return false;
+    fInfo.shmaddr = (char *) shmat(fInfo.shmid, nullptr, 0);
+    fInfo.readOnly = True;
+    if (fInfo.shmaddr == (char *) -1) {
+        shmctl(fInfo.shmid, IPC_RMID, nullptr);
+        fInfo.shmaddr = nullptr;
+        return false;
+    }
+
+    if (fMajor == 0) {
+        int event, error;
+        if (!XQueryExtension(display, "MIT-SHM", &fMajor, &event, &error))
+            fMajor = -1;
+    }
+
+    // Only claim an error of our attach and not a pending one.
+    XSync(display, False);
+    fOldHandler = XSetErrorHandler(attachError);
+    bool attached = XShmAttach(display, &fInfo);
+    XSync(display, False);
+    XSetErrorHandler(fOldHandler);
+    fOldHandler = nullptr;
+
+    // the segment goes away when both sides have detached
+    shmctl(fInfo.shmid, IPC_RMID, nullptr);
+
+    if (attached && !fFailed) {
+        fSize = size;
+        fPending = 0;
+        return true;
+    }
+
+    fFailed = true;
+    shmdt(fInfo.shmaddr);
+    memset(&fInfo, 0, sizeof fInfo);
+    if (verbose)
+        tlog("MIT-SHM is unavailable for images");
+    return false;
+}
+
+XImage* YShmSegment::image(XImage* source) {
+    Display* display = xapp->display();
+    const unsigned w = source->width;
+    const unsigned h = source->height;
+
+    XImage* ximage = XShmCreateImage(display,
+                                     xapp->visualForDepth(source->depth),
+                                     source->depth, ZPixmap, nullptr,
+                                     &fInfo, w, h);
+    if (ximage == nullptr)
+        return nullptr;
+
+    const size_t size = size_t(ximage->bytes_per_line) * h;
+    if (reserve(size) == false) {
+        XDestroyImage(ximage);
+        return nullptr;
+    }
+    ximage->data = fInfo.shmaddr;
+    ximage->obdata = (char *) &fInfo;
+
+    // wait for the server only when it may still read the previous put
+    if (fPending && LastKnownRequestProcessed(display) < fPending)
+        XSync(display, False);
+    fPending = 0;
+
+    if (source->bytes_per_line == ximage->bytes_per_line &&
+        source->byte_order == ximage->byte_order &&
+        source->bits_per_pixel == ximage->bits_per_pixel)
+    {
+        memcpy(ximage->data, source->data, size);
+    }
+    else {
+        asmart<uint32_t> row(new uint32_t[w]);
+        for (unsigned j = 0; j < h; j++) {
+            YXImage::getRow(source, j, row);
+            YXImage::putRow(ximage, j, row);
         }
-        // tlog("created upscale ximage at %ux%ux%u\n", ximage->width, ximage->height, ximage->depth);
-        if (!(chanls = (double *)calloc(ximage->bytes_per_line * ximage->height, 4 * sizeof(*chanls)))) {
-            tlog("ERROR: could not allocate working arrays\n");
-            goto error;
+    }
+    return ximage;
+}
+
+// Send part of an image to a drawable, by shared memory when possible.
+static void putImage(Drawable drawable, GC gc, XImage* ximage,
+                     int sx, int sy, int dx, int dy,
+                     unsigned w, unsigned h)
+{
+    if (YShmSegment::wanted(ximage)) {
+        XImage* shared = shmSegment.image(ximage);
+        if (shared) {
+            XShmPutImage(xapp->display(), drawable, gc, shared,
+                         sx, sy, dx, dy, w, h, False);
+            shmSegment.pending();
+            shared->data = nullptr;
+            XDestroyImage(shared);
+            return;
         }
-        if (!(counts = (double *)calloc(ximage->bytes_per_line * ximage->height, sizeof(*counts)))) {
-            tlog("ERROR: could not allocate working arrays\n");
-            goto error;
+    }
+    XPutImage(xapp->display(), drawable, gc, ximage, sx, sy, dx, dy, w, h);
+}
+
+static int hostByteOrder() {
+    const unsigned one = 1;
+    return *(const char *) &one ? LSBFirst : MSBFirst;
+}
+
+static inline uint32_t swapBytes(uint32_t p) {
+    return (p >> 24) | ((p >> 8) & 0xFF00) | ((p << 8) & 0xFF0000) | (p << 24);
+}
+
+// Scale the colors of ARGB pixels by their alpha.
+static void premultiply(uint32_t* row, unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        const uint32_t p = row[i], a = (p >> 24) + 1;
+        row[i] = (p & 0xFF000000)
+               | ((((p >> 16) & 0xFF) * a >> 8) << 16)
+               | ((((p >> 8) & 0xFF) * a >> 8) << 8)
+               | ((p & 0xFF) * a >> 8);
+    }
+}
+
+static inline unsigned char reverseBits(unsigned char b) {
+    b = (unsigned char) ((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = (unsigned char) ((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    return (unsigned char) ((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+// The pixel data if it holds 32-bit pixels in host byte order.
+uint32_t* YXImage::nativePixels(XImage* ximage) {
+    if (ximage->format == ZPixmap &&
+        ximage->bits_per_pixel == 32 &&
+        ximage->byte_order == hostByteOrder() &&
+        ximage->bytes_per_line % 4 == 0)
+        return (uint32_t *) ximage->data;
+    return nullptr;
+}
+
+// Whether the image holds 32-bit pixels in the other byte order.
+bool YXImage::swappedPixels(XImage* ximage) {
+    return ximage->format == ZPixmap &&
+           ximage->bits_per_pixel == 32 &&
+           ximage->byte_order != hostByteOrder() &&
+           ximage->bytes_per_line % 4 == 0;
+}
+
+// Read one row of pixel values, masked to the depth like XGetPixel does.
+void YXImage::getRow(XImage* ximage, unsigned y, uint32_t* row) {
+    const unsigned w = ximage->width;
+    const uint32_t* data = (const uint32_t *)
+        (ximage->data + size_t(y) * ximage->bytes_per_line);
+    const uint32_t mask = ximage->depth < 32
+                        ? (1U << ximage->depth) - 1 : 0xFFFFFFFF;
+
+    if (nativePixels(ximage)) {
+        for (unsigned i = 0; i < w; i++)
+            row[i] = data[i] & mask;
+    }
+    else if (swappedPixels(ximage)) {
+        for (unsigned i = 0; i < w; i++)
+            row[i] = swapBytes(data[i]) & mask;
+    }
+    else {
+        for (unsigned i = 0; i < w; i++)
+            row[i] = uint32_t(XGetPixel(ximage, i, y));
+    }
+}
+
+void YXImage::putRow(XImage* ximage, unsigned y, const uint32_t* row) {
+    const unsigned w = ximage->width;
+    uint32_t* data = (uint32_t *)
+        (ximage->data + size_t(y) * ximage->bytes_per_line);
+
+    if (nativePixels(ximage)) {
+        memcpy(data, row, w * sizeof(*row));
+    }
+    else if (swappedPixels(ximage)) {
+        for (unsigned i = 0; i < w; i++)
+            data[i] = swapBytes(row[i]);
+    }
+    else {
+        for (unsigned i = 0; i < w; i++)
+            XPutPixel(ximage, i, y, row[i]);
+    }
+}
+
+// Whether pixel x of a bitmap is bit x % 8 of byte x / 8 in bit order.
+bool YXImage::directBits(XImage* ximage) {
+    return ximage->depth == 1 &&
+           ximage->xoffset == 0 &&
+           (ximage->format == XYBitmap || ximage->format == XYPixmap) &&
+           (ximage->bitmap_unit == 8 ||
+            ximage->byte_order == ximage->bitmap_bit_order);
+}
+
+// Eight mask bits for pixels with an alpha of at least ATH.
+static inline unsigned alphaBits(const uint32_t* p, unsigned n) {
+    unsigned bits = 0;
+#ifdef __SSE2__
+    if (n == 8) {
+        // unsigned compare as signed with flipped sign bits
+        const __m128i sign = _mm_set1_epi32(int(0x80000000));
+        const __m128i limit = _mm_set1_epi32(int((ATH << 24) - 1) ^ int(0x80000000));
+        __m128i lo = _mm_loadu_si128((const __m128i *) p);
+        __m128i hi = _mm_loadu_si128((const __m128i *) (p + 4));
+        lo = _mm_cmpgt_epi32(_mm_xor_si128(lo, sign), limit);
+        hi = _mm_cmpgt_epi32(_mm_xor_si128(hi, sign), limit);
+        return unsigned(_mm_movemask_ps(_mm_castsi128_ps(lo))) |
+               unsigned(_mm_movemask_ps(_mm_castsi128_ps(hi))) << 4;
+    }
+#endif
+    for (unsigned i = 0; i < n; i++)
+        bits |= unsigned(p[i] >= (ATH << 24)) << i;
+    return bits;
+}
+
+// Set mask bits for pixels which are opaque enough to be shown.
+void YXImage::putMaskRow(XImage* xmask, unsigned y, const uint32_t* row) {
+    const unsigned w = xmask->width;
+    unsigned char* bits = (unsigned char *) xmask->data
+                        + size_t(y) * xmask->bytes_per_line;
+
+    if (directBits(xmask)) {
+        const bool msb = (xmask->bitmap_bit_order == MSBFirst);
+        for (unsigned x = 0; x < w; x += 8) {
+            unsigned char b = (unsigned char) alphaBits(row + x, min(8U, w - x));
+            bits[x / 8] = msb ? reverseBits(b) : b;
         }
-        if (!(colors = (double *)calloc(ximage->bytes_per_line * ximage->height, sizeof(*colors)))) {
-            tlog("ERROR: could not allocate working arrays\n");
-            goto error;
+    }
+    else {
+        for (unsigned x = 0; x < w; x++)
+            XPutPixel(xmask, x, y, row[x] >= (ATH << 24));
+    }
+}
+
+// Read all pixels as ARGB; opaque if the image has no alpha channel.
+void YXImage::getPixels(uint32_t* pixels, bool bitmap) const {
+    const unsigned w = fImage->width;
+    const unsigned h = fImage->height;
+    const uint32_t opaque = hasAlpha() ? 0 : 0xFF000000;
+
+    for (unsigned j = 0; j < h; j++, pixels += w) {
+        getRow(fImage, j, pixels);
+        for (unsigned i = 0; i < w; i++) {
+            if (bitmap && (pixels[i] & 0x00FFFFFF))
+                pixels[i] |= 0x00FFFFFF;
+            pixels[i] |= opaque;
         }
-        {
-            double pppx = (double) w / (double) nw;
-            double pppy = (double) h / (double) nh;
-
-            double ty, by; unsigned l;
-            for (ty = 0.0, by = pppy, l = 0; l < nh; l++, ty += pppy, by += pppy) {
-                for (unsigned j = floor(ty); j < by; j++) {
-                    double yf = 1.0;
-                    if (ty < (j + 1) && (j + 1) < by)
-                        yf = (j + 1) - ty;
-                    else if (ty < j && j < by)
-                        yf = by - j;
-                    double lx, rx; unsigned k;
-                    for (lx = 0.0, rx = pppx, k = 0; k < nw; k++, lx += pppx, rx += pppx) {
-                        for (unsigned i = floor(lx); i < rx; i++) {
-                            double xf = 1.0;
-                            if (lx < (i + 1) && (i + 1) < rx)
-                                xf = (i + 1) - lx;
-                            else if (lx < i && i < rx)
-                                xf = rx - i;
-                            double ff = xf * yf;
-                            unsigned m = l * nw + k;
-                            unsigned n = m << 2;
-                            counts[m] += ff;
-                            unsigned long pixel = XGetPixel(fImage, i, j);
-                            if (fBitmap && (pixel & 0x00FFFFFF))
-                                pixel |= 0x00FFFFFF;
-                            unsigned A = has_alpha ? (pixel >> 24) & 0xff : 255;
-                            unsigned R = (pixel >> 16) & 0xff;
-                            unsigned G = (pixel >>  8) & 0xff;
-                            unsigned B = (pixel >>  0) & 0xff;
-                            colors[m] += ff;
-                            chanls[n+0] += A * ff;
-                            chanls[n+1] += R * ff;
-                            chanls[n+2] += G * ff;
-                            chanls[n+3] += B * ff;
-                        }
-                    }
-                }
-            }
-            unsigned amax = 0;
-            for (unsigned l = 0; l < nh; l++) {
-                for (unsigned k = 0; k < nw; k++) {
-                    unsigned m = l * nw + k;
-                    unsigned n = m << 2;
-                    unsigned long pixel = 0;
-                    if (counts[m])
-                        pixel |= (lround(chanls[n+0] / counts[m]) & 0xff) << 24;
-                    if (colors[m]) {
-                        pixel |= (lround(chanls[n+1] / colors[m]) & 0xff) << 16;
-                        pixel |= (lround(chanls[n+2] / colors[m]) & 0xff) <<  8;
-                        pixel |= (lround(chanls[n+3] / colors[m]) & 0xff) <<  0;
-                    }
-                    XPutPixel(ximage, k, l, pixel);
-                    amax = max(amax, (unsigned)((pixel >> 24) & 0xff));
-                }
-            }
-            if (!amax)
-                /* no opacity at all! */
-                for (unsigned l = 0; l < nh; l++)
-                    for (unsigned k = 0; k < nw; k++)
-                        XPutPixel(ximage, k, l, XGetPixel(ximage, k, l) | 0xFF000000);
-            else if (amax < 255) {
-                double bump = (double) 255 / (double) amax;
-                for (unsigned l = 0; l < nh; l++)
-                    for (unsigned k = 0; k < nw; k++) {
-                        unsigned long pixel = XGetPixel(ximage, k, l);
-                        amax = (pixel >> 24) & 0xff;
-                        amax = lround((double) amax * bump);
-                        if (amax > 255)
-                            amax = 255;
-                        pixel = (pixel & 0x00FFFFFF) | (amax << 24);
-                        XPutPixel(ximage, k, l, pixel);
-                    }
-            }
-            image.init(new YXImage(ximage, fBitmap));
-            ximage = 0; // consumed above
+    }
+}
+
+bool YXImage::readPixels(uint32_t* argb) const {
+    if (hasAlpha() == false)
+        return false;
+    getPixels(argb, false);
+    return true;
+}
+
+void YXImage::putPixels(XImage* ximage, const uint32_t* pixels) {
+    const unsigned w = ximage->width;
+    const unsigned h = ximage->height;
+
+    for (unsigned j = 0; j < h; j++, pixels += w)
+        putRow(ximage, j, pixels);
+}
+
+// image upscaling by area averaging
+ref<YImage> YXImage::upscale(unsigned nw, unsigned nh)
+{
+    if (!valid()) {
+        tlog("ERROR: not a valid YXImage\n");
+        return null;
+    }
+
+    const unsigned w = fImage->width;
+    const unsigned h = fImage->height;
+    XImage* ximage = createImage(nw, nh, fImage->depth);
+    if (ximage == 0)
+        return null;
+
+    asmart<uint32_t> source(new uint32_t[w * h]);
+    asmart<uint32_t> target(new uint32_t[nw * nh]);
+    getPixels(source, fBitmap);
+    YScaler::scale(source, w, h, w, target, nw, nh, nw);
+    stretchAlpha(target, nw * nh);
+    putPixels(ximage, target);
+
+    return ref<YImage>(new YXImage(ximage, fBitmap));
+}
+
+// Raise the alpha of upscaled pixels to full opacity at the maximum.
+void YXImage::stretchAlpha(uint32_t* target, unsigned count)
+{
+    unsigned amax = 0;
+    for (unsigned m = 0; m < count; m++)
+        amax = max(amax, unsigned(target[m] >> 24));
+    if (!amax) {
+        /* no opacity at all! */
+        for (unsigned m = 0; m < count; m++)
+            target[m] |= 0xFF000000;
+    }
+    else if (amax < 255) {
+        double bump = (double) 255 / (double) amax;
+        for (unsigned m = 0; m < count; m++) {
+            unsigned alpha = min(255U, unsigned(lround((target[m] >> 24) * bump)));
+            target[m] = (target[m] & 0x00FFFFFF) | (alpha << 24);
         }
     }
-  error:
-    if (chanls)
-        free(chanls);
-    if (counts)
-        free(counts);
-    if (colors)
-        free(colors);
-    if (ximage)
-        XDestroyImage(ximage);
-    return image;
 }
 
-// image downscaling using a fast bilinear interpolation algorithm
+// image downscaling by area averaging
 ref<YImage> YXImage::downscale(unsigned newWidth, unsigned newHeight)
 {
     const unsigned oldWidth = this->width();
     const unsigned oldHeight = this->height();
-    const unsigned shift = 10;
 
     PRECONDITION(inrange(newWidth, 1U, oldWidth));
     PRECONDITION(inrange(newHeight, 1U, oldHeight));
@@ -788,122 +1198,26 @@ ref<YImage> YXImage::downscale(unsigned newWidth, unsigned newHeight)
     if (ximage == 0)
         return null;
 
-    unsigned long *red = new unsigned long[newWidth];
-    unsigned long *grn = new unsigned long[newWidth];
-    unsigned long *blu = new unsigned long[newWidth];
-    unsigned long *alp = new unsigned long[newWidth];
-    unsigned long *div = new unsigned long[newWidth];
-
-    unsigned hacc = 0;
-    unsigned h = 0;
-    unsigned mult = 0;
-    bool repeat = false;
-
-    for (unsigned y = 0; y < oldHeight; y = repeat ? y : 1 + y) {
-        if (hacc < newHeight) {
-            memset(red, 0, sizeof(*red) * newWidth);
-            memset(grn, 0, sizeof(*grn) * newWidth);
-            memset(blu, 0, sizeof(*blu) * newWidth);
-            memset(alp, 0, sizeof(*alp) * newWidth);
-            memset(div, 0, sizeof(*div) * newWidth);
-        }
-
-        if (repeat) {
-            repeat = false;
-            mult = (1 << shift) - mult;
-        }
-        else {
-            hacc += newHeight;
-            if (hacc <= oldHeight) {
-                mult = 1 << shift;
-            }
-            else {
-                mult = ((newHeight / 2) + (1 << shift)
-                     * (newHeight - (hacc - oldHeight)))
-                     / newHeight;
-            }
-        }
-
-        unsigned wacc = 0;
-        unsigned w = 0;
-        unsigned char* idata = (unsigned char *) fImage->data
-                               + y * fImage->bytes_per_line;
-        const bool has_alpha = hasAlpha();
-        for (unsigned x = 0; x < oldWidth; ++x) {
-            unsigned char r, g, b, a;
-            if (fImage->byte_order == MSBFirst) {
-                a = has_alpha ? *idata++ : 0xFF;
-                r = *idata++;
-                g = *idata++;
-                b = *idata++;
-            } else {
-                b = *idata++;
-                g = *idata++;
-                r = *idata++;
-                a = has_alpha ? *idata++ : 0xFF;
-            }
-
-            wacc += newWidth;
-            if (wacc < oldWidth) {
-                red[w] += (mult << shift) * r;
-                grn[w] += (mult << shift) * g;
-                blu[w] += (mult << shift) * b;
-                alp[w] += (mult << shift) * a;
-                div[w] += mult << shift;
-            }
-            else {
-                unsigned m = (newWidth / 2 + (1 << shift)
-                           * (newWidth - (wacc - oldWidth)))
-                           / newWidth;
-                red[w] += m * mult * r;
-                grn[w] += m * mult * g;
-                blu[w] += m * mult * b;
-                alp[w] += m * mult * a;
-                div[w] += m * mult;
-                ++w;
-                wacc -= oldWidth;
-                if (wacc > 0) {
-                    m = (1 << shift) - m;
-                    red[w] += m * mult * r;
-                    grn[w] += m * mult * g;
-                    blu[w] += m * mult * b;
-                    alp[w] += m * mult * a;
-                    div[w] += m * mult;
-                }
-            }
-        }
-
-        if (hacc >= oldHeight) {
-            hacc -= oldHeight;
-            if (hacc > 0) {
-                repeat = true;
-            }
-            unsigned char* odata = (unsigned char *) ximage->data
-                                   + h * ximage->bytes_per_line;
-            for (unsigned k = 0; k < newWidth; ++k) {
-                unsigned long d = non_zero(div[k]);
-                if (ximage->byte_order == MSBFirst) {
-                    *odata++ = (unsigned char) (alp[k] / d);
-                    *odata++ = (unsigned char) (red[k] / d);
-                    *odata++ = (unsigned char) (grn[k] / d);
-                    *odata++ = (unsigned char) (blu[k] / d);
-                }
-                else {
-                    *odata++ = (unsigned char) (blu[k] / d);
-                    *odata++ = (unsigned char) (grn[k] / d);
-                    *odata++ = (unsigned char) (red[k] / d);
-                    *odata++ = (unsigned char) (alp[k] / d);
-                }
-            }
-            ++h;
-        }
+    asmart<uint32_t> source;
+    const uint32_t* pixels = hasAlpha() ? nativePixels(fImage) : nullptr;
+    unsigned stride = fImage->bytes_per_line / 4;
+    if (pixels == nullptr) {
+        pixels = source = new uint32_t[oldWidth * oldHeight];
+        stride = oldWidth;
+        getPixels(source, false);
     }
 
-    delete[] red;
-    delete[] grn;
-    delete[] blu;
-    delete[] alp;
-    delete[] div;
+    if (uint32_t* target = nativePixels(ximage)) {
+        YScaler::scale(pixels, oldWidth, oldHeight, stride,
+                       target, newWidth, newHeight,
+                       ximage->bytes_per_line / 4);
+    }
+    else {
+        asmart<uint32_t> buffer(new uint32_t[newWidth * newHeight]);
+        YScaler::scale(pixels, oldWidth, oldHeight, stride,
+                       buffer, newWidth, newHeight, newWidth);
+        putPixels(ximage, buffer);
+    }
 
     return ref<YImage>(new YXImage(ximage));
 }
@@ -944,6 +1258,35 @@ ref<YImage> YXImage::scale(unsigned nw, unsigned nh)
     return upscale(nw, nh);
 }
 
+bool YImage::loadPixels(upath filename, unsigned width, unsigned height,
+                        uint32_t* argb)
+{
+    mstring ext(filename.getExtension().lower());
+    uint32_t* pixels = nullptr;
+    unsigned w = 0, h = 0;
+#ifdef CONFIG_LIBPNG
+    if (ext == ".png")
+        pixels = YXImage::decodepng(filename, width, height, &w, &h);
+#endif
+#ifdef CONFIG_LIBJPEG
+    if (ext == ".jpg" || ext == ".jpeg")
+        pixels = YXImage::decodejpg(filename, width, height, &w, &h);
+#endif
+    if (pixels == nullptr)
+        return false;
+
+    // the same scaling as YXImage::scale, but without an XImage
+    if (w == width && h == height)
+        memcpy(argb, pixels, size_t(w) * h * sizeof(uint32_t));
+    else {
+        YScaler::scale(pixels, w, h, w, argb, width, height, width);
+        if (width > w || height > h)
+            YXImage::stretchAlpha(argb, width * height);
+    }
+    free(pixels);
+    return true;
+}
+
 ref<YImage> YImage::createFromPixmap(ref<YPixmap> pixmap)
 {
     return createFromPixmapAndMask(pixmap->pixmap(),
@@ -1022,12 +1365,26 @@ ref<YImage> YXImage::combine(XImage *xdraw, XImage *xmask)
     // tlog("created ximage for combine at %ux%ux%u with mask %ux%ux%u\n",
     //      ximage->width, ximage->height, ximage->depth,
     //      xmask->width, xmask->height, xmask->depth);
-    for (unsigned j = 0; j < h; j++)
-        for (unsigned i = 0; i < w; i++)
-            if (XGetPixel(xmask, i, j))
-                XPutPixel(ximage, i, j, XGetPixel(xdraw, i, j) | 0xFF000000);
-            else
-                XPutPixel(ximage, i, j, XGetPixel(xdraw, i, j) & 0x00FFFFFF);
+    {
+        asmart<uint32_t> row(new uint32_t[w]);
+        const bool direct = directBits(xmask);
+        const bool msb = (xmask->bitmap_bit_order == MSBFirst);
+        for (unsigned j = 0; j < h; j++) {
+            const unsigned char* bits = (unsigned char *) xmask->data
+                                      + size_t(j) * xmask->bytes_per_line;
+            getRow(xdraw, j, row);
+            for (unsigned i = 0; i < w; i++) {
+                bool opaque = direct
+                    ? (bits[i / 8] >> (msb ? 7 - i % 8 : i % 8)) & 1
+                    : XGetPixel(xmask, i, j) != 0;
+                if (opaque)
+                    row[i] |= 0xFF000000;
+                else
+                    row[i] &= 0x00FFFFFF;
+            }
+            putRow(ximage, j, row);
+        }
+    }
     image.init(new YXImage(ximage, bitmap));
     return image;
   error:
@@ -1048,9 +1405,14 @@ ref<YImage> YImage::createFromIconProperty(long *prop_pixels, unsigned w, unsign
         goto error;
     }
     // tlog("created ximage for icon %ux%ux%u\n", ximage->width, ximage->height, ximage->depth);
-    for (unsigned j = 0; j < h; j++)
-        for (unsigned i = 0; i < w; i++, prop_pixels++)
-            XPutPixel(ximage, i, j, *prop_pixels);
+    {
+        asmart<uint32_t> row(new uint32_t[w]);
+        for (unsigned j = 0; j < h; j++) {
+            for (unsigned i = 0; i < w; i++, prop_pixels++)
+                row[i] = uint32_t(*prop_pixels);
+            YXImage::putRow(ximage, j, row);
+        }
+    }
     image.init(new YXImage(ximage));
     return image;
   error:
@@ -1059,6 +1421,19 @@ ref<YImage> YImage::createFromIconProperty(long *prop_pixels, unsigned w, unsign
     return image;
 }
 
+ref<YImage> YImage::createFromPixels(const uint32_t* argb,
+                                     unsigned w, unsigned h)
+{
+    ref<YImage> image;
+    XImage* ximage = YXImage::createImage(w, h, 32U);
+    if (ximage) {
+        for (unsigned j = 0; j < h; j++, argb += w)
+            YXImage::putRow(ximage, j, argb);
+        image.init(new YXImage(ximage));
+    }
+    return image;
+}
+
 ref<YImage> YImage::createFromPixmapAndMaskScaled(Pixmap pix, Pixmap mask,
                                                    unsigned w, unsigned h,
                                                    unsigned nw, unsigned nh)
@@ -1072,7 +1447,6 @@ ref<YImage> YImage::createFromPixmapAndMaskScaled(Pixmap pix, Pixmap mask,
 ref <YPixmap> YXImage::renderToPixmap(unsigned depth, bool premult)
 {
     ref <YPixmap> pixmap;
-    bool has_mask = false;
     XImage *xdraw = 0, *xmask = 0;
     Pixmap draw = None, mask = None;
     XGCValues xg;
@@ -1089,22 +1463,12 @@ ref <YPixmap> YXImage::renderToPixmap(unsigned depth, bool premult)
     {
         unsigned w = fImage->width;
         unsigned h = fImage->height;
-        if (hasAlpha())
-            for (unsigned j = 0; !has_mask && j < h; j++)
-                for (unsigned i = 0; !has_mask && i < w; i++)
-                    if (((XGetPixel(fImage, i, j) >> 24) & 0xff) < 128)
-                        has_mask = true;
-        if (hasAlpha() || depth != this->depth()) {
+        bool convert = hasAlpha() || depth != this->depth();
+        if (convert) {
             xdraw = createImage(w, h, depth);
             if (xdraw == 0) {
                 goto error;
             }
-            for (unsigned j = 0; j < h; j++)
-                for (unsigned i = 0; i < w; i++)
-                    XPutPixel(xdraw, i, j, XGetPixel(fImage, i, j));
-        } else if (!(xdraw = XSubImage(fImage, 0, 0, w, h))) {
-            tlog("ERROR: could not create subimage %ux%u\n", w, h);
-            goto error;
         }
         // tlog("created ximage %ux%ux%u for pixmap\n", xdraw->width, xdraw->height, xdraw->depth);
 
@@ -1112,29 +1476,41 @@ ref <YPixmap> YXImage::renderToPixmap(unsigned depth, bool premult)
         if (xmask == 0) {
             goto error;
         }
-        for (unsigned j = 0; j < h; j++)
-            for (unsigned i = 0; i < w; i++)
-                XPutPixel(xmask, i, j,
-                          !has_mask ||
-                          ((XGetPixel(fImage, i, j) >> 24) & 0xff) >= ATH);
+        if (hasAlpha() || convert) {
+            asmart<uint32_t> row(new uint32_t[w]);
+            const bool multiply = premult && hasAlpha();
+            for (unsigned j = 0; j < h; j++) {
+                getRow(fImage, j, row);
+                if (hasAlpha())
+                    putMaskRow(xmask, j, row);
+                if (multiply)
+                    premultiply(row, w);
+                if (convert)
+                    putRow(xdraw, j, row);
+            }
+        }
+        if (!hasAlpha())
+            memset(xmask->data, 0xFF, size_t(xmask->bytes_per_line) * h);
         // tlog("created ximage %ux%ux%u for mask\n", xmask->width, xmask->height, xmask->depth);
-
+    }
+    {
+        XImage* ximage = xdraw ? xdraw : fImage;
         // tlog("next request %lu at %s: +%d : %s()\n", NextRequest(xapp->display()), __FILE__, __LINE__, __func__);
-        draw = XCreatePixmap(xapp->display(), xapp->root(), xdraw->width, xdraw->height, xdraw->depth);
+        draw = XCreatePixmap(xapp->display(), xapp->root(), ximage->width, ximage->height, ximage->depth);
         if (!draw) {
-            tlog("ERROR: could not create pixmap %ux%ux%u\n", xdraw->width, xdraw->height, xdraw->depth);
+            tlog("ERROR: could not create pixmap %ux%ux%u\n", ximage->width, ximage->height, ximage->depth);
             goto error;
         }
-        // tlog("created pixmap 0x%lx %ux%ux%u for pixmap\n", draw, xdraw->width, xdraw->height, xdraw->depth);
+        // tlog("created pixmap 0x%lx %ux%ux%u for pixmap\n", draw, ximage->width, ximage->height, ximage->depth);
         gcd = XCreateGC(xapp->display(), draw, 0UL, &xg);
         if (!gcd) {
             tlog("ERROR: could not create GC for pixmap 0x%lx %ux%ux%u\n",
-                    draw, xdraw->width, xdraw->height, xdraw->depth);
+                    draw, ximage->width, ximage->height, ximage->depth);
             goto error;
         }
-        // tlog("putting ximage %ux%ux%u to pixmap\n", xdraw->width, xdraw->height, xdraw->depth);
+        // tlog("putting ximage %ux%ux%u to pixmap\n", ximage->width, ximage->height, ximage->depth);
         // tlog("next request %lu at %s: +%d : %s()\n", NextRequest(xapp->display()), __FILE__, __LINE__, __func__);
-        XPutImage(xapp->display(), draw, gcd, xdraw, 0, 0, 0, 0, xdraw->width, xdraw->height);
+        putImage(draw, gcd, ximage, 0, 0, 0, 0, ximage->width, ximage->height);
 
         // tlog("next request %lu at %s: +%d : %s()\n", NextRequest(xapp->display()), __FILE__, __LINE__, __func__);
         mask = XCreatePixmap(xapp->display(), xapp->root(), xmask->width, xmask->height, 1);
@@ -1154,7 +1530,7 @@ ref <YPixmap> YXImage::renderToPixmap(unsigned depth, bool premult)
         // tlog("next request %lu at %s: +%d : %s()\n", NextRequest(xapp->display()), __FILE__, __LINE__, __func__);
         XPutImage(xapp->display(), mask, gcm, xmask, 0, 0, 0, 0, xmask->width, xmask->height);
 
-        pixmap = createPixmap(draw, mask, xdraw->width, xdraw->height, depth);
+        pixmap = createPixmap(draw, mask, ximage->width, ximage->height, depth);
         draw = mask = None; // consumed above
     }
   error:
@@ -1271,7 +1647,7 @@ void YXImage::composite(Graphics& g, int x, int y,
         tlog("simply putting %ux%u+0+0 of ximage %ux%ux%u onto drawable %ux%ux%u at +%d+%d\n",
               w, h, wi, hi, di, _w, _h, _d, dx-g.xorigin(), dy-g.yorigin());
         // tlog("next request %lu at %s: +%d : %s()\n", NextRequest(xapp->display()), __FILE__, __LINE__, __func__);
-        XPutImage(xapp->display(), g.drawable(), g.handleX(), fImage,  0, 0, dx - g.xorigin(), dy - g.yorigin(), w, h);
+        putImage(g.drawable(), g.handleX(), fImage, 0, 0, dx - g.xorigin(), dy - g.yorigin(), w, h);
         return;
     }
 
@@ -1330,7 +1706,7 @@ void YXImage::composite(Graphics& g, int x, int y,
     tlog("putting %ux%u+0+0 of ximage %ux%ux%u on drawable %ux%ux%u at +%d+%d\n",
           w, h, xback->width, xback->height, xback->depth, _w, _h, _d, dx-g.xorigin(), dy-g.yorigin());
     // tlog("next request %lu at %s: +%d : %s()\n", NextRequest(xapp->display()), __FILE__, __LINE__, __func__);
-    XPutImage(xapp->display(), g.drawable(), g.handleX(), xback, 0, 0, dx - g.xorigin(), dy - g.yorigin(), w, h);
+    putImage(g.drawable(), g.handleX(), xback, 0, 0, dx - g.xorigin(), dy - g.yorigin(), w, h);
     XDestroyImage(xback);
 }
 